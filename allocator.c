@@ -0,0 +1,243 @@
+#include "allocator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "lexico.h"
+#include "stats.h"
+
+static void* systemAllocate(Allocator* self, size_t size) {
+    (void)self;
+    return malloc(size);
+}
+
+static void* systemReallocate(Allocator* self, void* block, size_t oldSize, size_t newSize) {
+    (void)self;
+    (void)oldSize;
+    return realloc(block, newSize);
+}
+
+static void systemRelease(Allocator* self, void* block, size_t size) {
+    (void)self;
+    (void)size;
+    free(block);
+}
+
+static void* countingAllocate(Allocator* self, size_t size) {
+    void* block = systemAllocate(self, size);
+    if (block) {
+        recordAllocation(size);
+    }
+    return block;
+}
+
+static void* countingReallocate(Allocator* self, void* block, size_t oldSize, size_t newSize) {
+    void* moved = systemReallocate(self, block, oldSize, newSize);
+    if (moved) {
+        recordRelease(oldSize);
+        recordAllocation(newSize);
+    }
+    return moved;
+}
+
+static void countingRelease(Allocator* self, void* block, size_t size) {
+    if (block) {
+        recordRelease(size);
+    }
+    systemRelease(self, block, size);
+}
+
+// Live blocks of the tracking allocator, in an open-addressing table kept
+// on the system heap so it does not count itself
+typedef struct {
+    void* block;
+    size_t size;
+} LiveBlock;
+
+static LiveBlock* liveBlocks = NULL;
+static size_t liveBlockCapacity = 0;
+static size_t liveBlockCount = 0;
+static size_t sizeMismatches = 0;
+static size_t unknownReleases = 0;
+
+static size_t blockSlot(const void* block, size_t capacity) {
+    uintptr_t hash = (uintptr_t)block;
+    hash ^= hash >> 17;
+    hash *= 0x9E3779B97F4A7C15ULL;
+    return (size_t)(hash & (capacity - 1));
+}
+
+static bool insertLiveBlock(void* block, size_t size);
+
+static bool growLiveBlocks(void) {
+    size_t oldCapacity = liveBlockCapacity;
+    LiveBlock* old = liveBlocks;
+    size_t capacity = oldCapacity ? oldCapacity * 2 : 256;
+
+    LiveBlock* table = calloc(capacity, sizeof(LiveBlock));
+    if (!table) {
+        return false;
+    }
+    liveBlocks = table;
+    liveBlockCapacity = capacity;
+    liveBlockCount = 0;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].block) {
+            insertLiveBlock(old[i].block, old[i].size);
+        }
+    }
+    free(old);
+    return true;
+}
+
+static bool insertLiveBlock(void* block, size_t size) {
+    if ((liveBlockCount + 1) * 4 > liveBlockCapacity * 3 && !growLiveBlocks()) {
+        return false;
+    }
+    size_t slot = blockSlot(block, liveBlockCapacity);
+    while (liveBlocks[slot].block) {
+        slot = (slot + 1) & (liveBlockCapacity - 1);
+    }
+    liveBlocks[slot].block = block;
+    liveBlocks[slot].size = size;
+    liveBlockCount++;
+    return true;
+}
+
+// Removes a block and returns the size it was allocated with, or false if
+// it was never handed out by this allocator
+static bool removeLiveBlock(void* block, size_t* size) {
+    if (liveBlockCapacity == 0) {
+        return false;
+    }
+    size_t slot = blockSlot(block, liveBlockCapacity);
+    while (liveBlocks[slot].block && liveBlocks[slot].block != block) {
+        slot = (slot + 1) & (liveBlockCapacity - 1);
+    }
+    if (!liveBlocks[slot].block) {
+        return false;
+    }
+    *size = liveBlocks[slot].size;
+    liveBlocks[slot].block = NULL;
+    liveBlockCount--;
+
+    // Reinsert the rest of the cluster so lookups keep finding it
+    for (size_t next = (slot + 1) & (liveBlockCapacity - 1); liveBlocks[next].block;
+         next = (next + 1) & (liveBlockCapacity - 1)) {
+        LiveBlock moved = liveBlocks[next];
+        liveBlocks[next].block = NULL;
+        liveBlockCount--;
+        insertLiveBlock(moved.block, moved.size);
+    }
+    return true;
+}
+
+static void forgetBlock(void* block, size_t size) {
+    size_t recorded;
+    if (!removeLiveBlock(block, &recorded)) {
+        unknownReleases++;
+    } else if (recorded != size) {
+        sizeMismatches++;
+    }
+}
+
+static void* trackingAllocate(Allocator* self, size_t size) {
+    void* block = countingAllocate(self, size);
+    if (block) {
+        insertLiveBlock(block, size);
+    }
+    return block;
+}
+
+// The old block is forgotten before realloc may free it, and restored if
+// the call fails
+static void* trackingReallocate(Allocator* self, void* block, size_t oldSize, size_t newSize) {
+    if (block) {
+        forgetBlock(block, oldSize);
+    }
+    void* moved = countingReallocate(self, block, oldSize, newSize);
+    if (moved) {
+        insertLiveBlock(moved, newSize);
+    } else if (block) {
+        insertLiveBlock(block, oldSize);
+    }
+    return moved;
+}
+
+static void trackingRelease(Allocator* self, void* block, size_t size) {
+    if (block) {
+        forgetBlock(block, size);
+    }
+    countingRelease(self, block, size);
+}
+
+Allocator systemAllocator = {"system", systemAllocate, systemReallocate, systemRelease};
+Allocator countingAllocator = {"counting", countingAllocate, countingReallocate, countingRelease};
+Allocator trackingAllocator = {"tracking", trackingAllocate, trackingReallocate, trackingRelease};
+
+static Allocator* currentAllocator = &countingAllocator;
+
+// Must be chosen before anything is allocated: blocks are released through
+// the allocator that is current at the time
+void setAllocator(Allocator* allocator) {
+    currentAllocator = allocator ? allocator : &countingAllocator;
+}
+
+Allocator* getAllocator(void) {
+    return currentAllocator;
+}
+
+Allocator* findAllocator(const char* name) {
+    Allocator* allocators[] = {&systemAllocator, &countingAllocator, &trackingAllocator};
+    for (size_t i = 0; i < sizeof(allocators) / sizeof(allocators[0]); i++) {
+        if (strcmp(allocators[i]->name, name) == 0) {
+            return allocators[i];
+        }
+    }
+    return NULL;
+}
+
+void* compilerAlloc(size_t size) {
+    return currentAllocator->allocate(currentAllocator, size);
+}
+
+void* compilerRealloc(void* block, size_t oldSize, size_t newSize) {
+    return currentAllocator->reallocate(currentAllocator, block, oldSize, newSize);
+}
+
+void compilerFree(void* block, size_t size) {
+    currentAllocator->release(currentAllocator, block, size);
+}
+
+char* compilerStrdup(const char* text) {
+    size_t size = strlen(text) + 1;
+    char* copy = compilerAlloc(size);
+    if (copy) {
+        memcpy(copy, text, size);
+    }
+    return copy;
+}
+
+// Blocks still live and releases that did not match an allocation
+void printAllocatorReport(void) {
+    if (currentAllocator != &trackingAllocator) {
+        return;
+    }
+
+    size_t liveBytes = 0;
+    for (size_t i = 0; i < liveBlockCapacity; i++) {
+        if (liveBlocks[i].block) {
+            liveBytes += liveBlocks[i].size;
+        }
+    }
+    fprintf(compilerOutput, "\nAlocador: %zu bloco(s) vivo(s), %zu bytes", liveBlockCount, liveBytes);
+    fprintf(compilerOutput, "; %zu liberação(ões) com tamanho divergente, %zu desconhecida(s)\n",
+            sizeMismatches, unknownReleases);
+}
+
+void shutdownAllocator(void) {
+    free(liveBlocks);
+    liveBlocks = NULL;
+    liveBlockCapacity = 0;
+    liveBlockCount = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Heap interface used by the compiler subsystems. Callers pass the size of
+// the block back on reallocate and release, so implementations can account
+// for memory without keeping headers.
+typedef struct Allocator {
+    const char* name;
+    void* (*allocate)(struct Allocator* self, size_t size);
+    void* (*reallocate)(struct Allocator* self, void* block, size_t oldSize, size_t newSize);
+    void (*release)(struct Allocator* self, void* block, size_t size);
+} Allocator;
+
+extern Allocator systemAllocator;    // malloc/free, no accounting
+extern Allocator countingAllocator;  // Charges bytes to the running phase (default)
+extern Allocator trackingAllocator;  // Counting, plus a table of live blocks
+
+void setAllocator(Allocator* allocator);
+Allocator* getAllocator(void);
+Allocator* findAllocator(const char* name);
+
+void* compilerAlloc(size_t size);
+void* compilerRealloc(void* block, size_t oldSize, size_t newSize);
+void compilerFree(void* block, size_t size);
+char* compilerStrdup(const char* text);
+
+void printAllocatorReport(void);
+void shutdownAllocator(void);
+
+#endif
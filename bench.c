@@ -0,0 +1,606 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+#include "lexico.h"
+#include "parser.h"
+#include "intermediary.h"
+#include "semantic.h"
+#include "plancache.h"
+
+// Synthetic workloads for measuring each compiler phase. The generator is
+// seeded, so a given --seed/--scale always produces the same SQL.
+
+typedef enum {
+    WORKLOAD_WIDE,      // Wide projection
+    WORKLOAD_WHERE,     // Long WHERE chain
+    WORKLOAD_JOINS,     // Many joins
+    WORKLOAD_IN_LIST,   // Large IN list
+    WORKLOAD_MULTI,     // Many statements in one file
+    WORKLOAD_CACHED,    // One query shape with new literals, served from the plan cache
+    WORKLOAD_COUNT
+} Workload;
+
+static const char* WorkloadNames[] = {
+    "wide",
+    "where",
+    "joins",
+    "inlist",
+    "multi",
+    "cached"
+};
+
+typedef enum {
+    BENCH_LEXICAL,
+    BENCH_NORMALIZE,
+    BENCH_SYNTACTIC,
+    BENCH_SEMANTIC,
+    BENCH_INTERMEDIATE,
+    BENCH_PHASES
+} BenchPhase;
+
+static const char* BenchPhaseNames[] = {
+    "lexical",
+    "normalize",
+    "syntactic",
+    "semantic",
+    "intermediate",
+    "total"
+};
+
+#define MAX_RUNS 100
+
+// Median of repeated runs with a 95% confidence interval, in microseconds
+// per query
+typedef struct {
+    double median;
+    double low;
+    double high;
+} Measurement;
+
+typedef struct {
+    double phaseSeconds[BENCH_PHASES];
+    double* latencies;
+    long tokens;
+    int queries;
+    int cacheHits;
+    int errors;
+} WorkloadResult;
+
+static uint64_t rngState;
+
+// xorshift64*, enough for reproducible query shapes
+static uint64_t nextRandom(void) {
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 2685821657736338717ULL;
+}
+
+static int randomBelow(int limit) {
+    return (int)(nextRandom() % (uint64_t)limit);
+}
+
+static const char* comparisonOperators[] = {"=", "<", ">", "<=", ">=", "!="};
+
+static void writeValue(FILE* out) {
+    switch (randomBelow(3)) {
+        case 0:  fprintf(out, "%d", randomBelow(100000)); break;
+        case 1:  fprintf(out, "%d.%02d", randomBelow(1000), randomBelow(100)); break;
+        default: fprintf(out, "'v%d'", randomBelow(10000)); break;
+    }
+}
+
+static void writeSelect(FILE* out, int columns, int predicates, int joins) {
+    fprintf(out, "SELECT ");
+    for (int i = 0; i < columns; i++) {
+        fprintf(out, "%sc%d", i > 0 ? ", " : "", randomBelow(1000));
+        if (randomBelow(4) == 0) {
+            fprintf(out, " AS a%d", i);
+        }
+    }
+    fprintf(out, " FROM t0");
+    for (int i = 1; i <= joins; i++) {
+        fprintf(out, " JOIN t%d ON t%d.id = t%d.id", i, i - 1, i);
+    }
+    for (int i = 0; i < predicates; i++) {
+        fprintf(out, i == 0 ? " WHERE " : (randomBelow(4) == 0 ? " OR " : " AND "));
+        if (randomBelow(5) == 0) {
+            fprintf(out, "p%d BETWEEN %d AND %d", randomBelow(1000),
+                    randomBelow(500), 500 + randomBelow(500));
+        } else {
+            fprintf(out, "p%d %s ", randomBelow(1000), comparisonOperators[randomBelow(6)]);
+            writeValue(out);
+        }
+    }
+    fprintf(out, ";\n");
+}
+
+// Writes one query of the given workload; scale multiplies its size
+static void generateQuery(FILE* out, Workload workload, int scale) {
+    switch (workload) {
+        case WORKLOAD_WIDE:
+            writeSelect(out, 80 * scale, 1, 0);
+            break;
+        case WORKLOAD_WHERE:
+            writeSelect(out, 3, 40 * scale, 0);
+            break;
+        case WORKLOAD_JOINS:
+            writeSelect(out, 5, 2, 15 * scale);
+            break;
+        case WORKLOAD_IN_LIST:
+            fprintf(out, "SELECT id, name FROM t0 WHERE id IN (");
+            for (int i = 0; i < 256 * scale; i++) {
+                fprintf(out, "%s%d", i > 0 ? ", " : "", randomBelow(1000000));
+            }
+            fprintf(out, ");\n");
+            break;
+        case WORKLOAD_CACHED:
+            fprintf(out, "SELECT id, name FROM t0 JOIN t1 ON t0.id = t1.id "
+                         "WHERE p1 = %d AND p2 > %d.%02d AND p3 = 'v%d';\n",
+                    randomBelow(100000), randomBelow(1000), randomBelow(100), randomBelow(10000));
+            break;
+        default:
+            for (int i = 0; i < 100 * scale; i++) {
+                writeSelect(out, 1 + randomBelow(6), randomBelow(4), randomBelow(3));
+            }
+            break;
+    }
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double* sorted, int count, double p) {
+    int index = (int)(p * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+// Runs one query through every phase the way compileSQLStream does:
+// literals are normalized into parameters, and a plan cache hit skips
+// parsing, analysis and code generation
+static void runQuery(const char* sql, size_t length, WorkloadResult* result) {
+    double start = now();
+
+    FILE* input = fmemopen((void*)sql, length, "r");
+    TokenBuffer* buffer = createTokenBuffer();
+    if (!input || !buffer) {
+        fprintf(stderr, "bench: out of memory\n");
+        exit(1);
+    }
+
+    clearError();
+    resetSymbolTable();
+    int line = 1, column = 1;
+    Token token;
+    do {
+        token = getNextToken(input, &line, &column);
+        if (token.type == TOKEN_ERROR) {
+            result->errors++;
+        } else if (token.type != TOKEN_COMMENT && !addTokenToBuffer(buffer, token)) {
+            result->errors++;
+            break;
+        }
+    } while (token.type != TOKEN_EOF);
+    fclose(input);
+    double lexed = now();
+    int lexedTokens = buffer->count;   // Before IN lists collapse into one parameter
+
+    ParameterList parameters;
+    initParameterList(&parameters);
+    normalizeTokenBuffer(buffer, &parameters);
+    inferParameterTypes(buffer, &parameters);
+    unsigned int catalogVersion = getCatalogVersion();
+    bool cached = lookupPlan(buffer, catalogVersion);
+    double normalized = now();
+    double parsed = normalized;
+    double analyzed = normalized;
+    double generated = normalized;
+
+    if (!cached) {
+        parseTokenBuffer(buffer);
+        parsed = now();
+        analyzed = parsed;
+        generated = parsed;
+
+        if (getErrorMessage() == NULL) {
+            bool semanticOk = performSemanticAnalysis(buffer);
+            if (!semanticOk) {
+                result->errors++;
+            }
+            analyzed = now();
+            generateIntermediateCode(buffer);
+            if (semanticOk) {
+                storePlan(buffer, catalogVersion);
+            }
+            generated = now();
+        } else {
+            result->errors++;
+        }
+    }
+
+    result->phaseSeconds[BENCH_LEXICAL] += lexed - start;
+    result->phaseSeconds[BENCH_NORMALIZE] += normalized - lexed;
+    result->phaseSeconds[BENCH_SYNTACTIC] += parsed - normalized;
+    result->phaseSeconds[BENCH_SEMANTIC] += analyzed - parsed;
+    result->phaseSeconds[BENCH_INTERMEDIATE] += generated - analyzed;
+    result->latencies[result->queries++] = generated - start;
+    result->tokens += lexedTokens;
+    result->cacheHits += cached;
+    freeParameterList(&parameters);
+    freeTokenBuffer(buffer);
+}
+
+static void runWorkload(Workload workload, int iterations, int scale, WorkloadResult* result) {
+    free(result->latencies);
+    memset(result, 0, sizeof(*result));
+    result->latencies = malloc(sizeof(double) * iterations);
+    if (!result->latencies) {
+        fprintf(stderr, "bench: out of memory\n");
+        exit(1);
+    }
+
+    // Only the cached workload keeps plans between queries; the others
+    // measure a cold compile, as a single file on the command line gets
+    clearPlanCache();
+    for (int i = 0; i < iterations; i++) {
+        if (workload != WORKLOAD_CACHED) {
+            clearPlanCache();
+        }
+        char* sql = NULL;
+        size_t length = 0;
+        FILE* out = open_memstream(&sql, &length);
+        generateQuery(out, workload, scale);
+        fclose(out);
+        runQuery(sql, length, result);
+        free(sql);
+    }
+
+    qsort(result->latencies, result->queries, sizeof(double), compareDoubles);
+}
+
+static void printResult(Workload workload, const WorkloadResult* result) {
+    double total = 0;
+    for (int i = 0; i < BENCH_PHASES; i++) {
+        total += result->phaseSeconds[i];
+    }
+
+    printf("%-8s %7d %10ld %6d %6d", WorkloadNames[workload], result->queries,
+           result->tokens, result->errors, result->cacheHits);
+    for (int i = 0; i < BENCH_PHASES; i++) {
+        double seconds = result->phaseSeconds[i];
+        printf(" %12.0f", seconds > 0 ? result->tokens / seconds : 0.0);
+    }
+    printf(" %10.1f %9.1f %9.1f %9.1f\n",
+           total > 0 ? result->queries / total : 0.0,
+           percentile(result->latencies, result->queries, 0.50) * 1e6,
+           percentile(result->latencies, result->queries, 0.90) * 1e6,
+           percentile(result->latencies, result->queries, 0.99) * 1e6);
+}
+
+// Distribution-free interval for the median: the order statistics around
+// n/2 that cover it with ~95% probability
+static Measurement summarize(double* samples, int count) {
+    qsort(samples, count, sizeof(double), compareDoubles);
+    Measurement m;
+    m.median = count % 2 ? samples[count / 2]
+                         : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+    double spread = 0.98 * sqrt((double)count);
+    int lowRank = (int)floor(count / 2.0 - spread);
+    int highRank = (int)ceil(count / 2.0 + spread);
+    m.low = samples[lowRank < 0 ? 0 : lowRank];
+    m.high = samples[highRank > count - 1 ? count - 1 : highRank];
+    return m;
+}
+
+static bool saveBaseline(const char* path, unsigned long long seed, int iterations, int scale,
+                         int runs, Measurement results[WORKLOAD_COUNT][BENCH_PHASES + 1],
+                         const int errors[WORKLOAD_COUNT], int only) {
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "{\"seed\":%llu,\"iterations\":%d,\"scale\":%d,\"runs\":%d,\"results\":{",
+            seed, iterations, scale, runs);
+    bool first = true;
+    for (int w = 0; w < WORKLOAD_COUNT; w++) {
+        if (only >= 0 && w != only) {
+            continue;
+        }
+        for (int p = 0; p <= BENCH_PHASES; p++) {
+            const Measurement* m = &results[w][p];
+            fprintf(file, "%s\n  \"%s.%s\":{\"median\":%.6f,\"low\":%.6f,\"high\":%.6f}",
+                    first ? "" : ",", WorkloadNames[w], BenchPhaseNames[p],
+                    m->median, m->low, m->high);
+            first = false;
+        }
+    }
+    fprintf(file, "\n},\"errors\":{");
+    first = true;
+    for (int w = 0; w < WORKLOAD_COUNT; w++) {
+        if (only >= 0 && w != only) {
+            continue;
+        }
+        fprintf(file, "%s\"%s\":%d", first ? "" : ",", WorkloadNames[w], errors[w]);
+        first = false;
+    }
+    fprintf(file, "}}\n");
+    return fclose(file) == 0;
+}
+
+static char* readFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    char* text = NULL;
+    size_t length = 0;
+    FILE* out = open_memstream(&text, &length);
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        fwrite(chunk, 1, n, out);
+    }
+    fclose(file);
+    fclose(out);
+    return text;
+}
+
+// Reads back a file written by saveBaseline
+static bool findBaseline(const char* text, const char* workload, const char* phase,
+                         Measurement* m) {
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s.%s\":", workload, phase);
+    const char* entry = strstr(text, key);
+    return entry && sscanf(entry + strlen(key), "{\"median\":%lf,\"low\":%lf,\"high\":%lf}",
+                           &m->median, &m->low, &m->high) == 3;
+}
+
+// Errors a workload had when the baseline was recorded, or -1 when the
+// file predates the count
+static long findErrors(const char* text, const char* workload) {
+    const char* section = strstr(text, "\"errors\":{");
+    if (!section) {
+        return -1;
+    }
+    char key[32];
+    snprintf(key, sizeof(key), "\"%s\":", workload);
+    const char* entry = strstr(section, key);
+    return entry ? strtol(entry + strlen(key), NULL, 10) : -1;
+}
+
+static long findSetting(const char* text, const char* name) {
+    char key[32];
+    snprintf(key, sizeof(key), "\"%s\":", name);
+    const char* entry = strstr(text, key);
+    return entry ? strtol(entry + strlen(key), NULL, 10) : -1;
+}
+
+// A phase regresses when its median is slower than the threshold allows and
+// the confidence intervals do not overlap, so noise alone does not fail a run
+static int compareBaseline(const char* text, Measurement results[WORKLOAD_COUNT][BENCH_PHASES + 1],
+                           double threshold, int only) {
+    int regressions = 0;
+    printf("\n%-8s %-13s %10s %10s %8s\n", "workload", "phase", "base us", "now us", "change");
+    for (int w = 0; w < WORKLOAD_COUNT; w++) {
+        if (only >= 0 && w != only) {
+            continue;
+        }
+        for (int p = 0; p <= BENCH_PHASES; p++) {
+            Measurement base;
+            if (!findBaseline(text, WorkloadNames[w], BenchPhaseNames[p], &base)) {
+                continue;
+            }
+            const Measurement* now = &results[w][p];
+            double change = base.median > 0 ? (now->median - base.median) / base.median : 0;
+            bool regressed = change > threshold && now->low > base.high;
+            printf("%-8s %-13s %10.2f %10.2f %+7.1f%%%s\n", WorkloadNames[w], BenchPhaseNames[p],
+                   base.median, now->median, change * 100, regressed ? "  REGRESSION" : "");
+            regressions += regressed;
+        }
+    }
+    return regressions;
+}
+
+static bool parsePositive(const char* text, int* value) {
+    char* end;
+    long parsed = strtol(text, &end, 10);
+    if (*end != '\0' || parsed <= 0 || parsed > 1000000) {
+        return false;
+    }
+    *value = (int)parsed;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long long seed = 42;
+    int iterations = 200;
+    int scale = 1;
+    int runs = 1;
+    int only = -1;
+    double threshold = 0.10;
+    const char* baselinePath = NULL;
+    const char* savePath = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--iterations=", 13) == 0) {
+            if (!parsePositive(argv[i] + 13, &iterations)) {
+                fprintf(stderr, "bench: invalid --iterations\n");
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--scale=", 8) == 0) {
+            if (!parsePositive(argv[i] + 8, &scale)) {
+                fprintf(stderr, "bench: invalid --scale\n");
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--runs=", 7) == 0) {
+            if (!parsePositive(argv[i] + 7, &runs) || runs > MAX_RUNS) {
+                fprintf(stderr, "bench: invalid --runs (1-%d)\n", MAX_RUNS);
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--threshold=", 12) == 0) {
+            // Percentage
+            char* end;
+            threshold = strtod(argv[i] + 12, &end) / 100;
+            if (end == argv[i] + 12 || *end != '\0' || !isfinite(threshold) || threshold < 0) {
+                fprintf(stderr, "bench: invalid --threshold (a percentage >= 0)\n");
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--baseline=", 11) == 0) {
+            baselinePath = argv[i] + 11;
+        } else if (strncmp(argv[i], "--save-baseline=", 16) == 0) {
+            savePath = argv[i] + 16;
+        } else if (strncmp(argv[i], "--workload=", 11) == 0) {
+            for (int w = 0; w < WORKLOAD_COUNT; w++) {
+                if (strcmp(argv[i] + 11, WorkloadNames[w]) == 0) {
+                    only = w;
+                }
+            }
+            if (only < 0) {
+                fprintf(stderr, "bench: unknown workload '%s'\n", argv[i] + 11);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "usage: %s [--seed=N] [--iterations=N] [--scale=N] [--workload=NAME]\n"
+                            "       [--runs=N] [--save-baseline=FILE] [--baseline=FILE] [--threshold=PCT]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    char* baseline = NULL;
+    if (baselinePath) {
+        baseline = readFile(baselinePath);
+        if (!baseline) {
+            fprintf(stderr, "bench: cannot read baseline '%s'\n", baselinePath);
+            return 1;
+        }
+        if (findSetting(baseline, "seed") != (long)seed ||
+            findSetting(baseline, "iterations") != iterations ||
+            findSetting(baseline, "scale") != scale) {
+            fprintf(stderr, "bench: baseline was recorded with different seed/iterations/scale\n");
+            free(baseline);
+            return 1;
+        }
+    }
+
+    // Diagnostics from the phases are not part of the measurement
+    compilerOutput = fopen("/dev/null", "w");
+    if (!compilerOutput) {
+        compilerOutput = stderr;
+    }
+
+    printf("seed=%llu iterations=%d scale=%d runs=%d\n\n", seed, iterations, scale, runs);
+    printf("%-8s %7s %10s %6s %6s %12s %12s %12s %12s %12s %10s %9s %9s %9s\n",
+           "workload", "queries", "tokens", "errors", "hits", "lex tok/s", "norm tok/s",
+           "parse tok/s", "sem tok/s", "ir tok/s", "queries/s", "p50 us", "p90 us", "p99 us");
+
+    static double samples[WORKLOAD_COUNT][BENCH_PHASES + 1][MAX_RUNS];
+    static Measurement results[WORKLOAD_COUNT][BENCH_PHASES + 1];
+    int failedWorkloads = 0;
+    int errors[WORKLOAD_COUNT] = {0};
+
+    for (int w = 0; w < WORKLOAD_COUNT; w++) {
+        if (only >= 0 && w != only) {
+            continue;
+        }
+        WorkloadResult result = {0};
+        for (int run = 0; run < runs; run++) {
+            // Every run replays the same queries, and each workload starts
+            // from the seed so results do not depend on which were selected
+            rngState = seed ? seed : 1;
+            runWorkload((Workload)w, iterations, scale, &result);
+
+            double total = 0;
+            for (int p = 0; p < BENCH_PHASES; p++) {
+                samples[w][p][run] = result.phaseSeconds[p] / result.queries * 1e6;
+                total += samples[w][p][run];
+            }
+            samples[w][BENCH_PHASES][run] = total;
+        }
+        printResult((Workload)w, &result);
+        free(result.latencies);
+
+        // A failing query stops early, so its timings would look fast
+        errors[w] = result.errors;
+        if (result.errors > 0) {
+            fprintf(stderr, "bench: workload '%s' failed %d time(s); its timings measure the error "
+                            "path, not a compile\n", WorkloadNames[w], result.errors);
+            failedWorkloads++;
+        }
+
+        for (int p = 0; p <= BENCH_PHASES; p++) {
+            results[w][p] = summarize(samples[w][p], runs);
+        }
+    }
+
+    if (runs > 1) {
+        printf("\n%-8s %-13s %10s %10s %10s\n", "workload", "phase", "median us", "ci low", "ci high");
+        for (int w = 0; w < WORKLOAD_COUNT; w++) {
+            if (only >= 0 && w != only) {
+                continue;
+            }
+            for (int p = 0; p <= BENCH_PHASES; p++) {
+                printf("%-8s %-13s %10.2f %10.2f %10.2f\n", WorkloadNames[w], BenchPhaseNames[p],
+                       results[w][p].median, results[w][p].low, results[w][p].high);
+            }
+        }
+    }
+
+    int status = failedWorkloads > 0;
+    if (failedWorkloads > 0 && (savePath || baseline)) {
+        fprintf(stderr, "bench: not %s a baseline while workloads report errors\n",
+                savePath ? "saving" : "comparing against");
+        free(baseline);
+        baseline = NULL;
+        savePath = NULL;
+    }
+    if (baseline) {
+        for (int w = 0; w < WORKLOAD_COUNT; w++) {
+            long baselineErrors = only < 0 || w == only ? findErrors(baseline, WorkloadNames[w]) : 0;
+            if (baselineErrors != 0) {
+                fprintf(stderr, baselineErrors < 0 ?
+                        "bench: baseline has no error count for workload '%s'; record it again\n" :
+                        "bench: baseline has no clean run of workload '%s'\n", WorkloadNames[w]);
+                free(baseline);
+                baseline = NULL;
+                status = 1;
+                break;
+            }
+        }
+    }
+    if (savePath) {
+        if (saveBaseline(savePath, seed, iterations, scale, runs, results, errors, only)) {
+            printf("\nBaseline saved to %s\n", savePath);
+        } else {
+            fprintf(stderr, "bench: cannot write baseline '%s'\n", savePath);
+            status = 1;
+        }
+    }
+    if (baseline) {
+        int regressions = compareBaseline(baseline, results, threshold, only);
+        if (regressions > 0) {
+            printf("\n%d phase(s) regressed more than %.1f%%\n", regressions, threshold * 100);
+            status = 1;
+        }
+        free(baseline);
+    }
+
+    if (compilerOutput != stderr) {
+        fclose(compilerOutput);
+    }
+    return status;
+}
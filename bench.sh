@@ -0,0 +1,2 @@
+gcc bench.c lexico.c parser.c semantic.c intermediary.c plancache.c stats.c output.c allocator.c inlist.c -o bench -O2 -Wall -Wextra -Werror -lm
+./bench "$@"
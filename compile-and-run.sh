@@ -1,3 +1,3 @@
 rm compiler
-gcc compiler.c lexico.c parser.c semantic.c intermediary.c -o compiler -Wall -Wextra -fsanitize=address -g -fsanitize=undefined -fstack-protector -Werror
+gcc compiler.c lexico.c parser.c semantic.c intermediary.c plancache.c server.c stats.c output.c explain.c allocator.c incremental.c lexchunks.c inlist.c -o compiler -Wall -Wextra -fsanitize=address -g -fsanitize=undefined -fstack-protector -Werror -pthread -lm
 ./compiler
\ No newline at end of file
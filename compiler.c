@@ -1,86 +1,372 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "compiler.h"
+#include "server.h"
+#include "stats.h"
+#include "output.h"
+#include "explain.h"
+#include "allocator.h"
+#include "incremental.h"
+#include "lexchunks.h"
 
-void compileSQL(const char* filename) {
-    FILE *input = fopen(filename, "r");
-    if (!input) {
-        printf("Erro: Não foi possível abrir o arquivo '%s'\n", filename);
-        return;
+// Valores passados com --bind, associados aos '?' na ordem em que aparecem
+static const char** bindValues = NULL;
+static int bindValueCount = 0;
+
+static void bindPlaceholders(ParameterList* parameters) {
+    int next = 0;
+    for (int slot = 1; slot <= parameters->count && next < bindValueCount; slot++) {
+        QueryParameter* parameter = &parameters->parameters[slot - 1];
+        if (parameter->isBound) {
+            continue;
+        }
+        if (!bindParameter(parameters, slot, bindValues[next])) {
+            if (isTextOutput()) {
+                fprintf(compilerOutput, "Erro: valor '%s' incompatível com o parâmetro $%d (%s)\n",
+                       bindValues[next], slot, DataTypeNames[parameter->dataType]);
+            }
+            reportDiagnostic("bind", 0, 0, "Value incompatible with parameter type");
+        }
+        next++;
+    }
+}
+
+// Impresso junto dos parâmetros, na seção de código intermediário
+static void printUnboundParameters(const ParameterList* parameters) {
+    int unbound = countUnboundParameters(parameters);
+    if (unbound > 0 && shouldPrint(VERBOSITY_NORMAL)) {
+        fprintf(compilerOutput, "Consulta preparada com %d parâmetro(s) sem valor\n", unbound);
     }
+}
 
-    printf("Iniciando compilação SQL do arquivo: %s\n\n", filename);
+bool compileSQLStream(FILE* input, const char* filename) {
+    int diagnosticsBefore = getDiagnosticCount();
+    CompileStats statsBefore = *getCompileStats();
+    beginQueryStats();
+    if (shouldPrint(VERBOSITY_NORMAL)) {
+        fprintf(compilerOutput, "Iniciando compilação SQL do arquivo: %s\n\n", filename);
+    }
+    clearError();
+    resetSymbolTable();
     
     // Primeira passagem: Análise Léxica
-    printf("=== Análise Léxica ===\n");
+    beginPhase(PHASE_LEXICAL);
+    if (shouldPrint(VERBOSITY_NORMAL)) {
+        fprintf(compilerOutput, "=== Análise Léxica ===\n");
+    }
     int line = 1, column = 1;
     Token token;
     int lexicalErrors = 0;
+    bool printTokens = shouldPrint(VERBOSITY_DEBUG);
 
     // Criar buffer para tokens
     TokenBuffer* tokenBuffer = createTokenBuffer();
+    if (!tokenBuffer) {
+        if (isTextOutput()) {
+            fprintf(compilerOutput, "Erro: memória insuficiente para o buffer de tokens\n");
+        }
+        reportDiagnostic("lexical", 0, 0, "Out of memory for the token buffer");
+        endPhase(PHASE_LEXICAL);
+        emitCompilationResult(filename, false);
+        return false;
+    }
 
+    // Arquivos grandes podem ser lidos em partes por várias threads
+    LexedTokens lexed;
+    bool parallelLexing = lexInParallel(input, &lexed);
     do {
-        token = getNextToken(input, &line, &column);
+        token = parallelLexing ? nextLexedToken(&lexed) : getNextToken(input, &line, &column);
         
         // Armazenar token no buffer para análise sintática
-        if (token.type != TOKEN_ERROR && token.type != TOKEN_COMMENT) {
-            addTokenToBuffer(tokenBuffer, token);
+        if (token.type != TOKEN_ERROR && token.type != TOKEN_COMMENT &&
+            !addTokenToBuffer(tokenBuffer, token)) {
+            if (isTextOutput()) {
+                fprintf(compilerOutput, "\nErro: limite de memória de %zu bytes excedido na linha %d\n",
+                       getMemoryBudget(), token.line);
+                fprintf(compilerOutput, "\nCompilação interrompida devido a limite de memória\n");
+            }
+            reportDiagnostic("lexical", token.line, token.column, "Memory budget exceeded");
+            freeLexedTokens(&lexed);
+            freeTokenBuffer(tokenBuffer);
+            endPhase(PHASE_LEXICAL);
+            emitCompilationResult(filename, false);
+            return false;
         }
         
         // Imprimir informação do token
-        printf("Token: { Tipo: %s, Valor: '%s', Linha: %d, Coluna: %d }\n",
-               TokenTypeNames[token.type], token.value, token.line, token.column);
+        if (printTokens) {
+            fprintf(compilerOutput, "Token: { Tipo: %s, Valor: '%s', Linha: %d, Coluna: %d }\n",
+                   TokenTypeNames[token.type], token.value, token.line, token.column);
+        }
                
         if (token.type == TOKEN_ERROR) {
-            printf("\nErro Léxico na linha %d, coluna %d: %s\n",
-                   token.line, token.column, token.value);
+            if (isTextOutput()) {
+                fprintf(compilerOutput, "\nErro Léxico na linha %d, coluna %d: %s\n",
+                       token.line, token.column, token.value);
+            }
+            reportDiagnostic("lexical", token.line, token.column, token.value);
             lexicalErrors++;
         }
     } while (token.type != TOKEN_EOF && lexicalErrors < 10);
+    freeLexedTokens(&lexed);
 
     if (lexicalErrors > 0) {
-        printf("\nCompilação interrompida devido a erros léxicos\n");
+        if (isTextOutput()) {
+            fprintf(compilerOutput, "\nCompilação interrompida devido a erros léxicos\n");
+        }
         freeTokenBuffer(tokenBuffer);
-        fclose(input);
-        return;
+        endPhase(PHASE_LEXICAL);
+        emitCompilationResult(filename, false);
+        return false;
     }
 
     // Imprimir tabela de símbolos
-    printf("\nTabela de Símbolos após Análise Léxica:\n");
-    printSymbolTable();
+    if (printTokens) {
+        fprintf(compilerOutput, "\nTabela de Símbolos após Análise Léxica:\n");
+        printSymbolTable();
+    }
     
-    printf("\n=== Análise Sintática ===\n");
-    // Passar o buffer de tokens para o parser ao invés do arquivo
-    // parseTokenBuffer(tokenBuffer);
-
-    // Verificar erros sintáticos
-    if (getErrorMessage() != NULL) {
-        printf("\nErro Sintático na linha %d, coluna %d: %s\n",
-               currentError.line, currentError.column, getErrorMessage());
+    // Literais viram parâmetros para que consultas com o mesmo formato
+    // compartilhem o programa compilado
+    beginPhase(PHASE_NORMALIZE);
+    ParameterList parameters;
+    initParameterList(&parameters);
+    normalizeTokenBuffer(tokenBuffer, &parameters);
+    inferParameterTypes(tokenBuffer, &parameters);
+    bindPlaceholders(&parameters);
+    unsigned int catalogVersion = getCatalogVersion();
+    int instructions = 0;
+    bool explainAnalyze = false;
+    bool explain = isExplainStatement(tokenBuffer, &explainAnalyze);
+
+    if (lookupPlan(tokenBuffer, catalogVersion)) {
+        beginPhase(PHASE_INTERMEDIATE);
+        if (shouldPrint(VERBOSITY_NORMAL)) {
+            fprintf(compilerOutput, "\n=== Código Intermediário ===\n");
+            fprintf(compilerOutput, "Plano recuperado do cache (fingerprint %016llx)\n",
+                   fingerprintTokenBuffer(tokenBuffer));
+        }
+        if (shouldPrint(VERBOSITY_IR)) {
+            printIntermediateCode();
+            printParameters(&parameters);
+        }
+        printUnboundParameters(&parameters);
+        emitIntermediateCodeJson(filename, true, &parameters);
+        instructions = intermediateCodeContext.instructionCount;
+        if (explain && isTextOutput()) {
+            printExecutionPlan();
+        }
     } else {
-        printf("\nAnálise sintática completada com sucesso\n");
-        
-        // Adicionar análise semântica básica
-        printf("\n=== Análise Semântica ===\n");
-        if (performSemanticAnalysis(tokenBuffer)) {
-            printf("Análise semântica completada com sucesso\n");
+        beginPhase(PHASE_SYNTACTIC);
+        if (shouldPrint(VERBOSITY_NORMAL)) {
+            fprintf(compilerOutput, "\n=== Análise Sintática ===\n");
         }
+        // Passar o buffer de tokens para o parser ao invés do arquivo
+        parseTokenBuffer(tokenBuffer);
 
-        printf("\n=== Código Intermediário ===\n");
-        generateIntermediateCode(tokenBuffer);
-        printIntermediateCode();
+        // Verificar erros sintáticos
+        if (getErrorMessage() != NULL) {
+            if (isTextOutput()) {
+                fprintf(compilerOutput, "\nErro Sintático na linha %d, coluna %d: %s\n",
+                       currentError.line, currentError.column, getErrorMessage());
+            }
+            reportDiagnostic("syntactic", currentError.line, currentError.column, getErrorMessage());
+        } else {
+            if (shouldPrint(VERBOSITY_NORMAL)) {
+                fprintf(compilerOutput, "\nAnálise sintática completada com sucesso\n");
+            }
+
+            // Adicionar análise semântica básica
+            beginPhase(PHASE_SEMANTIC);
+            if (shouldPrint(VERBOSITY_NORMAL)) {
+                fprintf(compilerOutput, "\n=== Análise Semântica ===\n");
+            }
+            bool semanticOk = performSemanticAnalysis(tokenBuffer);
+            if (semanticOk && shouldPrint(VERBOSITY_NORMAL)) {
+                fprintf(compilerOutput, "Análise semântica completada com sucesso\n");
+            }
+
+            beginPhase(PHASE_INTERMEDIATE);
+            if (shouldPrint(VERBOSITY_NORMAL)) {
+                fprintf(compilerOutput, "\n=== Código Intermediário ===\n");
+            }
+            generateIntermediateCode(tokenBuffer);
+            if (shouldPrint(VERBOSITY_IR)) {
+                printIntermediateCode();
+                printParameters(&parameters);
+            }
+            printUnboundParameters(&parameters);
+            emitIntermediateCodeJson(filename, false, &parameters);
+            instructions = intermediateCodeContext.instructionCount;
+            if (explain && isTextOutput()) {
+                printExecutionPlan();
+            }
+
+            // Apenas programas válidos entram no cache
+            if (semanticOk) {
+                storePlan(tokenBuffer, catalogVersion);
+            }
+        }
     }
 
+    freeParameterList(&parameters);
+    recordCompilation(tokenBuffer->count, getSymbolCount(), instructions);
     freeTokenBuffer(tokenBuffer);
+    endActivePhase();
+    if (explainAnalyze && instructions > 0 && isTextOutput()) {
+        printExecutionAnalysis(&statsBefore);
+    }
+    if (shouldPrint(VERBOSITY_NORMAL)) {
+        fprintf(compilerOutput, "\nCompilação finalizada.\n");
+    }
+
+    bool ok = getDiagnosticCount() == diagnosticsBefore;
+    emitCompilationResult(filename, ok);
+    return ok;
+}
+
+bool compileSQL(const char* filename) {
+    FILE *input = fopen(filename, "r");
+    if (!input) {
+        if (isTextOutput()) {
+            fprintf(compilerOutput, "Erro: Não foi possível abrir o arquivo '%s'\n", filename);
+        }
+        reportDiagnostic("input", 0, 0, "Could not open file");
+        emitCompilationResult(filename, false);
+        return false;
+    }
+
+    bool ok = compileSQLStream(input, filename);
     fclose(input);
-    printf("\nCompilação finalizada.\n");
+    return ok;
 }
 
 int main(int argc, char *argv[]) {
-    const char* filename = (argc > 1) ? argv[1] : "test.sql";
-    compileSQL(filename);
-    return 0;
+    // Saída totalmente bufferizada: arquivos grandes geram muito texto
+    static char outputBuffer[1 << 16];
+    setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+    compilerOutput = stdout;
+    const char* filenames[argc > 1 ? argc : 1];
+    const char* values[argc > 1 ? argc : 1];
+    const char* edits[argc > 1 ? argc : 1];
+    int editCount = 0;
+    const char* planCacheFile = NULL;
+    const char* serveSocket = NULL;
+    const char* connectSocket = NULL;
+    bool showStats = false;
+    bool statsJson = false;
+    int fileCount = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--memory-budget=", 16) == 0) {
+            // Limite em megabytes
+            char* end;
+            unsigned long megabytes = strtoul(argv[i] + 16, &end, 10);
+            if (*end != '\0' || megabytes == 0) {
+                printf("Erro: valor inválido para --memory-budget: '%s'\n", argv[i] + 16);
+                return 1;
+            }
+            setMemoryBudget((size_t)megabytes * 1024 * 1024);
+        } else if (strncmp(argv[i], "--plan-cache-file=", 18) == 0) {
+            planCacheFile = argv[i] + 18;
+        } else if (strncmp(argv[i], "--serve=", 8) == 0) {
+            serveSocket = argv[i] + 8;
+        } else if (strncmp(argv[i], "--connect=", 10) == 0) {
+            connectSocket = argv[i] + 10;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            showStats = true;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            showStats = true;
+            statsJson = true;
+        } else if (strncmp(argv[i], "--allocator=", 12) == 0) {
+            Allocator* allocator = findAllocator(argv[i] + 12);
+            if (!allocator) {
+                printf("Erro: alocador desconhecido: '%s'\n", argv[i] + 12);
+                return 1;
+            }
+            setAllocator(allocator);
+        } else if (strcmp(argv[i], "--perf-counters") == 0) {
+            // Sem suporte do kernel os contadores ficam indisponíveis
+            enableHardwareCounters();
+        } else if (strncmp(argv[i], "--verbosity=", 12) == 0) {
+            Verbosity verbosity;
+            if (!parseVerbosity(argv[i] + 12, &verbosity)) {
+                printf("Erro: valor inválido para --verbosity: '%s'\n", argv[i] + 12);
+                return 1;
+            }
+            setVerbosity(verbosity);
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            setVerbosity(VERBOSITY_SILENT);
+        } else if (strcmp(argv[i], "--format=json") == 0) {
+            setOutputFormat(OUTPUT_JSON);
+        } else if (strncmp(argv[i], "--bind=", 7) == 0) {
+            values[bindValueCount++] = argv[i] + 7;
+        } else if (strncmp(argv[i], "--lex-threads=", 14) == 0) {
+            char* end;
+            long threads = strtol(argv[i] + 14, &end, 10);
+            if (*end != '\0' || threads < 1 || threads > LEX_MAX_THREADS) {
+                printf("Erro: valor inválido para --lex-threads: '%s'\n", argv[i] + 14);
+                return 1;
+            }
+            setLexThreads((int)threads);
+        } else if (strncmp(argv[i], "--edit=", 7) == 0) {
+            edits[editCount++] = argv[i] + 7;
+        } else {
+            filenames[fileCount++] = argv[i];
+        }
+    }
+
+    if (fileCount == 0) {
+        filenames[fileCount++] = "test.sql";
+    }
+    bindValues = values;
+
+    // Cliente: o servidor compila e devolve a saída
+    if (connectSocket) {
+        int status = 0;
+        for (int i = 0; i < fileCount; i++) {
+            status |= runClient(connectSocket, filenames[i]);
+        }
+        return status;
+    }
+
+    // Planos salvos por execuções anteriores evitam recompilar consultas
+    if (planCacheFile) {
+        loadPlanCache(planCacheFile);
+    }
+
+    // Arquivos compilados no mesmo processo compartilham o cache de planos
+    int status = 0;
+    if (editCount > 0) {
+        // Edições reanalisam apenas as instruções afetadas do primeiro arquivo
+        status = runIncrementalCheck(filenames[0], edits, editCount);
+    } else if (serveSocket) {
+        status = runServer(serveSocket);
+    } else {
+        for (int i = 0; i < fileCount; i++) {
+            if (!compileSQL(filenames[i])) {
+                status = 1;
+            }
+        }
+    }
+
+    if (planCacheFile && !savePlanCache(planCacheFile)) {
+        printf("Erro: não foi possível salvar o cache de planos em '%s'\n", planCacheFile);
+    }
+
+    // Medições acumuladas de todas as compilações do processo
+    if (showStats) {
+        printCompileStats(statsJson);
+    }
+
+    disableHardwareCounters();
+    clearPlanCache();
+    if (showStats) {
+        printAllocatorReport();
+    }
+    shutdownAllocator();
+    return status;
 }
 
 // gcc compiler.c lexico.c parser.c -o sqlcompiler
@@ -8,8 +8,10 @@
 #include "types.h"
 #include "lexico.h"
 #include "intermediary.h"
+#include "plancache.h"
 
 // Function declarations
-void compileSQL(const char* filename);
+bool compileSQLStream(FILE* input, const char* filename);
+bool compileSQL(const char* filename);
 
 #endif // COMPILER_H
\ No newline at end of file
@@ -0,0 +1,438 @@
+#include "explain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "lexico.h"
+#include "intermediary.h"
+
+static const char* PlanNodeNames[] = {
+    "Scan",
+    "Hash Join",
+    "Filter",
+    "Aggregate",
+    "Having",
+    "Sort",
+    "Top-N Sort",
+    "Limit",
+    "Project"
+};
+
+static PlanNode planNodes[MAX_PLAN_NODES];
+static int planNodeCount = 0;
+
+bool isExplainStatement(const TokenBuffer* buffer, bool* analyze) {
+    *analyze = false;
+    if (buffer->count == 0 || strcasecmp(buffer->tokens[0].value, "EXPLAIN") != 0) {
+        return false;
+    }
+    *analyze = buffer->count > 2 &&
+               strcasecmp(buffer->tokens[1].value, "ANALYZE") == 0 &&
+               strcasecmp(buffer->tokens[2].value, "SELECT") == 0;
+    return true;
+}
+
+// Instruction that defines a temporary, or NULL for names and literals
+static const IntermediateCodeInstruction* findDefinition(const char* name) {
+    if (name[0] != 'T') {
+        return NULL;
+    }
+    for (int i = intermediateCodeContext.instructionCount - 1; i >= 0; i--) {
+        const IntermediateCodeInstruction* instr = &intermediateCodeContext.instructions[i];
+        if (instr->type != IR_RETURN && strcmp(instr->result, name) == 0) {
+            return instr;
+        }
+    }
+    return NULL;
+}
+
+static void appendText(char* out, size_t size, const char* text) {
+    size_t length = strlen(out);
+    if (length + 1 < size) {
+        snprintf(out + length, size - length, "%s", text);
+    }
+}
+
+static void renderOperand(const char* operand, char* out, size_t size, int depth);
+
+// Expression computed by an instruction, with temporaries expanded
+static void renderInstruction(const IntermediateCodeInstruction* instr, char* out, size_t size,
+                              int depth) {
+    switch (instr->type) {
+        case IR_ARITHMETIC:
+            renderOperand(instr->op1, out, size, depth + 1);
+            appendText(out, size, " ");
+            appendText(out, size, instr->operation);
+            appendText(out, size, " ");
+            renderOperand(instr->op2, out, size, depth + 1);
+            break;
+        case IR_CONDITIONS:
+            renderOperand(instr->op1, out, size, depth + 1);
+            appendText(out, size, instr->operation);
+            appendText(out, size, " ");
+            renderOperand(instr->op2, out, size, depth + 1);
+            break;
+        case IR_BETWEEN:
+            renderOperand(instr->op1, out, size, depth + 1);
+            appendText(out, size, " BETWEEN ");
+            renderOperand(instr->op2, out, size, depth + 1);
+            break;
+        case IR_AGGREGATE:
+            appendText(out, size, instr->operation);
+            appendText(out, size, "(");
+            renderOperand(instr->op1, out, size, depth + 1);
+            appendText(out, size, ")");
+            break;
+        case IR_AS:
+            renderOperand(instr->op1, out, size, depth + 1);
+            appendText(out, size, " AS ");
+            appendText(out, size, instr->op2);
+            break;
+        case IR_PROJECT:
+            appendText(out, size, instr->op2[0] != '\0' ? instr->op2 : "*");
+            break;
+        default:
+            appendText(out, size, instr->result);
+            break;
+    }
+}
+
+// Copies operand word by word, expanding the temporaries it mentions
+static void renderOperand(const char* operand, char* out, size_t size, int depth) {
+    char word[MAX_OPERAND_LENGTH];
+    const char* cursor = operand;
+
+    while (*cursor) {
+        size_t length = strcspn(cursor, " ");
+        if (length >= sizeof(word)) {
+            length = sizeof(word) - 1;
+        }
+        memcpy(word, cursor, length);
+        word[length] = '\0';
+        cursor += length;
+
+        const IntermediateCodeInstruction* definition = depth < 16 ? findDefinition(word) : NULL;
+        if (definition) {
+            renderInstruction(definition, out, size, depth);
+        } else {
+            appendText(out, size, word);
+        }
+
+        while (*cursor == ' ') {
+            appendText(out, size, " ");
+            cursor++;
+        }
+    }
+}
+
+// Fraction of rows a predicate keeps: AND multiplies, OR adds the
+// independent probabilities
+static double estimateSelectivity(const char* operand, int depth) {
+    const IntermediateCodeInstruction* instr = depth < 16 ? findDefinition(operand) : NULL;
+    if (!instr) {
+        return 0.5;
+    }
+
+    char operation[MAX_OPERATOR_LENGTH];
+    snprintf(operation, sizeof(operation), "%s",
+             instr->operation[0] == ' ' ? instr->operation + 1 : instr->operation);
+
+    if (instr->type == IR_BETWEEN) {
+        return estimateOperatorSelectivity("BETWEEN");
+    }
+    if (strcmp(operation, "AND") == 0) {
+        return estimateSelectivity(instr->op1, depth + 1) * estimateSelectivity(instr->op2, depth + 1);
+    }
+    if (strcmp(operation, "OR") == 0) {
+        double left = estimateSelectivity(instr->op1, depth + 1);
+        double right = estimateSelectivity(instr->op2, depth + 1);
+        return left + right - left * right;
+    }
+    if (instr->type == IR_ARITHMETIC) {
+        return estimateOperatorSelectivity(operation);
+    }
+    return 0.5;
+}
+
+static int addPlanNode(PlanNodeType type, const char* detail, int left, int right) {
+    if (planNodeCount >= MAX_PLAN_NODES) {
+        return left;
+    }
+    PlanNode* node = &planNodes[planNodeCount];
+    node->type = type;
+    snprintf(node->detail, sizeof(node->detail), "%s", detail ? detail : "");
+    node->children[0] = left;
+    node->children[1] = right;
+    node->rows = 0;
+    node->cost = 0;
+    return planNodeCount++;
+}
+
+static bool isPipelineInstruction(IntermediateCodeType type) {
+    return type == IR_GROUP_BY || type == IR_HAVING || type == IR_ORDER_BY ||
+           type == IR_TOP_N || type == IR_LIMIT;
+}
+
+// Cardinality and cumulative cost of a node, from its inputs
+static void estimateNode(PlanNode* node, const IntermediateCodeInstruction* source) {
+    PlanNode* input = node->children[0] >= 0 ? &planNodes[node->children[0]] : NULL;
+    double rows = input ? input->rows : 0;
+    double cost = input ? input->cost : 0;
+
+    switch (node->type) {
+        case PLAN_SCAN:
+            rows = DEFAULT_TABLE_ROWS;
+            cost = rows;
+            break;
+        case PLAN_JOIN: {
+            // Equi-join on a key: one match per row of the larger side
+            if (node->children[1] < 0) {
+                break;
+            }
+            PlanNode* build = &planNodes[node->children[1]];
+            cost += build->cost + rows + build->rows;
+            rows = fmax(rows, build->rows);
+            break;
+        }
+        case PLAN_FILTER:
+            cost += rows;
+            rows *= estimateSelectivity(source->op1, 0);
+            break;
+        case PLAN_AGGREGATE:
+            cost += rows;
+            rows = node->detail[0] != '\0' && source ? fmax(1.0, rows * 0.1) : 1.0;
+            break;
+        case PLAN_HAVING: {
+            // The condition reads "aggregate operator value"
+            char operator[MAX_OPERATOR_LENGTH] = ">";
+            if (source) {
+                sscanf(source->operation, "%*s %19s", operator);
+            }
+            cost += rows;
+            rows *= estimateOperatorSelectivity(operator);
+            break;
+        }
+        case PLAN_SORT:
+            cost += rows * log2(rows + 1);
+            break;
+        case PLAN_TOP_N: {
+            double limit = atof(source->operation);
+            cost += rows * log2(limit + 1);
+            rows = fmin(rows, limit);
+            break;
+        }
+        case PLAN_LIMIT:
+            rows = fmax(0.0, fmin(rows - atof(source->operation), atof(source->op2)));
+            break;
+        case PLAN_PROJECT:
+            break;
+    }
+
+    node->rows = rows;
+    node->cost = cost;
+}
+
+static int planInstruction(PlanNodeType type, const char* detail, int input,
+                           const IntermediateCodeInstruction* source) {
+    int index = addPlanNode(type, detail, input, -1);
+    if (index != input) {
+        estimateNode(&planNodes[index], source);
+    }
+    return index;
+}
+
+// The intermediate code holds every statement of the input; the explained
+// one comes first and ends where the next statement's projection or
+// ANALYZE begins
+static int explainedStatementEnd(void) {
+    for (int i = 1; i < intermediateCodeContext.instructionCount; i++) {
+        const IntermediateCodeInstruction* instr = &intermediateCodeContext.instructions[i];
+        if ((instr->type == IR_PROJECT && strcmp(instr->op1, "temp_table") == 0) ||
+            instr->type == IR_ANALYZE) {
+            return i;
+        }
+    }
+    return intermediateCodeContext.instructionCount;
+}
+
+// Rebuilds the operator tree from the intermediate code: scans and joins,
+// the WHERE filter, then the clauses that consume it in order
+static int buildPlan(void) {
+    planNodeCount = 0;
+    const IntermediateCodeInstruction* project = NULL;
+    const IntermediateCodeInstruction* from = NULL;
+    const IntermediateCodeInstruction* firstPipeline = NULL;
+    const IntermediateCodeInstruction* returned = NULL;
+    char aggregates[MAX_TOKEN_LENGTH] = "";
+    int end = explainedStatementEnd();
+
+    for (int i = 0; i < end; i++) {
+        const IntermediateCodeInstruction* instr = &intermediateCodeContext.instructions[i];
+        if (instr->type == IR_SELECT && !project) {
+            project = instr;
+        } else if (instr->type == IR_FROM && !from) {
+            from = instr;
+        } else if (isPipelineInstruction(instr->type) && !firstPipeline) {
+            firstPipeline = instr;
+        } else if (instr->type == IR_RETURN) {
+            returned = instr;
+        } else if (instr->type == IR_AGGREGATE && !firstPipeline) {
+            char rendered[MAX_TOKEN_LENGTH] = "";
+            renderInstruction(instr, rendered, sizeof(rendered), 0);
+            if (aggregates[0] != '\0') {
+                appendText(aggregates, sizeof(aggregates), ", ");
+            }
+            appendText(aggregates, sizeof(aggregates), rendered);
+        }
+    }
+
+    if (!from) {
+        return -1;
+    }
+
+    int root = planInstruction(PLAN_SCAN, from->op2, -1, from);
+
+    for (int i = 0; i < end; i++) {
+        const IntermediateCodeInstruction* instr = &intermediateCodeContext.instructions[i];
+        if (instr->type != IR_JOIN) {
+            continue;
+        }
+        int right = planInstruction(PLAN_SCAN, instr->op1, -1, instr);
+        if (right < 0) {
+            break;  // Node table full: the plan ends at the joins built so far
+        }
+        char condition[MAX_TOKEN_LENGTH] = "";
+        renderOperand(instr->op2, condition, sizeof(condition), 0);
+        int join = addPlanNode(PLAN_JOIN, condition, root, right);
+        if (join != root) {
+            estimateNode(&planNodes[join], instr);
+            root = join;
+        }
+    }
+
+    // The WHERE condition is whatever feeds the first clause after it, or
+    // ends the statement
+    if (!returned && end > 0) {
+        returned = &intermediateCodeContext.instructions[end - 1];
+    }
+    const char* input = firstPipeline ? firstPipeline->op1 : (returned ? returned->result : "");
+    const IntermediateCodeInstruction* filter = findDefinition(input);
+    if (filter && filter->type != IR_FROM && filter->type != IR_JOIN &&
+        filter->type != IR_SELECT && !isPipelineInstruction(filter->type)) {
+        IntermediateCodeInstruction predicate = *filter;
+        snprintf(predicate.op1, sizeof(predicate.op1), "%s", input);
+        char condition[MAX_TOKEN_LENGTH] = "";
+        renderOperand(input, condition, sizeof(condition), 0);
+        root = planInstruction(PLAN_FILTER, condition, root, &predicate);
+    }
+
+    bool grouped = false;
+    for (int i = 0; i < end; i++) {
+        const IntermediateCodeInstruction* instr = &intermediateCodeContext.instructions[i];
+        char detail[MAX_TOKEN_LENGTH] = "";
+
+        // Aggregates without GROUP BY fold every row into one
+        if (!grouped && aggregates[0] != '\0' && isPipelineInstruction(instr->type) &&
+            instr->type != IR_GROUP_BY) {
+            root = planInstruction(PLAN_AGGREGATE, "", root, NULL);
+            grouped = true;
+        }
+
+        switch (instr->type) {
+            case IR_GROUP_BY:
+                snprintf(detail, sizeof(detail), "%s", instr->op2);
+                if (aggregates[0] != '\0') {
+                    appendText(detail, sizeof(detail), "; ");
+                    appendText(detail, sizeof(detail), aggregates);
+                }
+                root = planInstruction(PLAN_AGGREGATE, detail, root, instr);
+                grouped = true;
+                break;
+            case IR_HAVING:
+                renderOperand(instr->operation, detail, sizeof(detail), 0);
+                root = planInstruction(PLAN_HAVING, detail, root, instr);
+                break;
+            case IR_ORDER_BY:
+                root = planInstruction(PLAN_SORT, instr->op2, root, instr);
+                break;
+            case IR_TOP_N:
+                snprintf(detail, sizeof(detail), "%s rows by %s", instr->operation, instr->op2);
+                root = planInstruction(PLAN_TOP_N, detail, root, instr);
+                break;
+            case IR_LIMIT:
+                snprintf(detail, sizeof(detail), "%s", instr->op2);
+                if (instr->operation[0] != '\0') {
+                    appendText(detail, sizeof(detail), " offset ");
+                    appendText(detail, sizeof(detail), instr->operation);
+                }
+                root = planInstruction(PLAN_LIMIT, detail, root, instr);
+                break;
+            default:
+                break;
+        }
+    }
+    if (!grouped && aggregates[0] != '\0') {
+        root = planInstruction(PLAN_AGGREGATE, "", root, NULL);
+    }
+
+    if (project) {
+        char columns[MAX_TOKEN_LENGTH] = "";
+        renderOperand(project->op1, columns, sizeof(columns), 0);
+        root = planInstruction(PLAN_PROJECT, columns, root, project);
+    }
+    return root;
+}
+
+static void printPlanNode(int index, int depth) {
+    const PlanNode* node = &planNodes[index];
+    fprintf(compilerOutput, "%*s%s%s", depth * 4, "", depth > 0 ? "-> " : "",
+            PlanNodeNames[node->type]);
+    if (node->detail[0] != '\0') {
+        fprintf(compilerOutput, " (%s)", node->detail);
+    }
+    fprintf(compilerOutput, "  (rows=%.0f cost=%.2f)\n", node->rows, node->cost);
+
+    for (int i = 0; i < 2; i++) {
+        if (node->children[i] >= 0) {
+            printPlanNode(node->children[i], depth + 1);
+        }
+    }
+}
+
+// Prints the plan of the current intermediate code with estimates
+void printExecutionPlan(void) {
+    fprintf(compilerOutput, "\n=== Plano de Execução ===\n");
+    int root = buildPlan();
+    if (root < 0) {
+        fprintf(compilerOutput, "Nenhum operador para planejar\n");
+        return;
+    }
+    printPlanNode(root, 0);
+}
+
+// The compiler does not execute queries, so EXPLAIN ANALYZE reports what
+// it can measure: how long each phase took to produce this plan
+void printExecutionAnalysis(const CompileStats* before) {
+    const CompileStats* after = getCompileStats();
+
+    fprintf(compilerOutput, "\nExecução: não disponível (linhas e tempos reais exigem um executor)\n");
+    fprintf(compilerOutput, "Compilação:\n");
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const PhaseStats* start = &before->phases[i];
+        const PhaseStats* end = &after->phases[i];
+        if (end->runs == start->runs) {
+            continue;
+        }
+        fprintf(compilerOutput, "  %-13s time=%.3f ms memory=%zu bytes", CompilePhaseNames[i],
+                (end->wallSeconds - start->wallSeconds) * 1e3,
+                end->bytesAllocated - start->bytesAllocated);
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (isHardwareCounterAvailable((HardwareCounter)c)) {
+                fprintf(compilerOutput, " %s=%llu", HardwareCounterNames[c],
+                        end->counters[c] - start->counters[c]);
+            }
+        }
+        fputc('\n', compilerOutput);
+    }
+}
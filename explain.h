@@ -0,0 +1,37 @@
+#ifndef EXPLAIN_H
+#define EXPLAIN_H
+
+#include <stdbool.h>
+#include "types.h"
+#include "stats.h"
+
+// Rows assumed for a table; ANALYZE does not collect statistics yet
+#define DEFAULT_TABLE_ROWS 1000.0
+#define MAX_PLAN_NODES (MAX_JOINS * 2 + 16)
+
+typedef enum {
+    PLAN_SCAN,
+    PLAN_JOIN,
+    PLAN_FILTER,
+    PLAN_AGGREGATE,
+    PLAN_HAVING,
+    PLAN_SORT,
+    PLAN_TOP_N,
+    PLAN_LIMIT,
+    PLAN_PROJECT
+} PlanNodeType;
+
+// Operator of the plan tree derived from the intermediate code
+typedef struct {
+    PlanNodeType type;
+    char detail[MAX_TOKEN_LENGTH];
+    double rows;
+    double cost;
+    int children[2];    // Indexes into the plan, -1 when absent
+} PlanNode;
+
+bool isExplainStatement(const TokenBuffer* buffer, bool* analyze);
+void printExecutionPlan(void);
+void printExecutionAnalysis(const CompileStats* before);
+
+#endif
@@ -0,0 +1,430 @@
+#define _GNU_SOURCE
+#include "incremental.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "compiler.h"
+#include "allocator.h"
+#include "output.h"
+
+static const char* DiagnosticPhaseLabels[] = {
+    "Léxico",
+    "de Normalização",
+    "Sintático",
+    "Semântico",
+    "de Código Intermediário"
+};
+
+static void setDiagnostic(StatementDiagnostic* diagnostic, CompilePhase phase,
+                          int line, int column, const char* message) {
+    diagnostic->ok = false;
+    diagnostic->phase = phase;
+    diagnostic->line = line;
+    diagnostic->column = column;
+    snprintf(diagnostic->message, sizeof(diagnostic->message), "%s", message);
+}
+
+// Finds the end of the statement starting at 'start' with the lexer's rules
+// for quotes and -- comments, so a ';' inside either is not a boundary.
+// The scanner is back in its initial state after every boundary, which is
+// what lets a rescan stop as soon as it lands on an old one.
+static size_t scanStatement(const char* text, size_t length, size_t start, StatementView* view) {
+    size_t i = start;
+    size_t lineStart = start;
+    int newlines = 0;
+
+    while (i < length) {
+        char c = text[i++];
+        if (c == ';') {
+            break;
+        } else if (c == '\n') {
+            newlines++;
+            lineStart = i;
+        } else if (c == '-' && i < length && text[i] == '-') {
+            while (i < length && text[i] != '\n') {
+                i++;
+            }
+        } else if (c == '\'' || c == '"') {
+            // Same cut as the lexer: past MAX_STRING_CONTENT the literal
+            // ends, the byte it stops on is dropped and the rest is unquoted
+            int content = 0;
+            while (i < length) {
+                char inside = text[i++];
+                if (inside == '\n') {
+                    newlines++;
+                    lineStart = i;
+                }
+                if (inside == c || content++ >= MAX_STRING_CONTENT) {
+                    break;
+                }
+            }
+        }
+    }
+
+    memset(view, 0, sizeof(*view));
+    view->length = i - start;
+    view->newlines = newlines;
+    view->lastLineLength = (int)(i - lineStart);
+    return i;
+}
+
+// Lexes, parses and analyzes one statement on its own. Output the phases
+// print is discarded; only the first error is kept.
+static void checkStatement(const char* text, StatementView* view) {
+    static const char emptyStatement[] = " ";
+    StatementDiagnostic* diagnostic = &view->diagnostic;
+    memset(diagnostic, 0, sizeof(*diagnostic));
+    diagnostic->ok = true;
+
+    char* captured = NULL;
+    size_t capturedLength = 0;
+    FILE* input = view->length > 0 ? fmemopen((void*)text, view->length, "r")
+                                   : fmemopen((void*)emptyStatement, 1, "r");
+    FILE* output = open_memstream(&captured, &capturedLength);
+    TokenBuffer* tokens = createTokenBuffer();
+    if (!input || !output || !tokens) {
+        if (input) fclose(input);
+        if (output) fclose(output);
+        if (tokens) freeTokenBuffer(tokens);
+        free(captured);
+        setDiagnostic(diagnostic, PHASE_LEXICAL, 0, 0, "Out of memory");
+        return;
+    }
+
+    FILE* previousOutput = compilerOutput;
+    compilerOutput = output;
+    clearError();
+    resetSymbolTable();
+
+    beginPhase(PHASE_LEXICAL);
+    int line = 1, column = 1;
+    Token token;
+    do {
+        token = getNextToken(input, &line, &column);
+        if (token.type == TOKEN_ERROR) {
+            setDiagnostic(diagnostic, PHASE_LEXICAL, token.line, token.column, token.value);
+        } else if (token.type != TOKEN_COMMENT && !addTokenToBuffer(tokens, token)) {
+            setDiagnostic(diagnostic, PHASE_LEXICAL, token.line, token.column,
+                          "Memory budget exceeded");
+        }
+    } while (token.type != TOKEN_EOF && diagnostic->ok);
+
+    if (diagnostic->ok) {
+        beginPhase(PHASE_SYNTACTIC);
+        parseTokenBuffer(tokens);
+        if (getErrorMessage() != NULL) {
+            setDiagnostic(diagnostic, PHASE_SYNTACTIC, currentError.line, currentError.column,
+                          getErrorMessage());
+        }
+    }
+
+    if (diagnostic->ok) {
+        beginPhase(PHASE_SEMANTIC);
+        if (!performSemanticAnalysis(tokens)) {
+            const char* first = getFirstSemanticError();
+            setDiagnostic(diagnostic, PHASE_SEMANTIC, tokens->tokens[0].line,
+                          tokens->tokens[0].column, first ? first : "Semantic analysis failed");
+        }
+    }
+    endActivePhase();
+
+    compilerOutput = previousOutput;
+    fclose(output);
+    fclose(input);
+    free(captured);
+    freeTokenBuffer(tokens);
+}
+
+static bool reserveStatements(SqlDocument* document, int needed) {
+    if (needed <= document->capacity) {
+        return true;
+    }
+    int capacity = document->capacity ? document->capacity : 16;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    StatementView* statements = compilerRealloc(document->statements,
+                                                 sizeof(StatementView) * document->capacity,
+                                                 sizeof(StatementView) * capacity);
+    if (!statements) {
+        return false;
+    }
+    document->statements = statements;
+    document->capacity = capacity;
+    return true;
+}
+
+SqlDocument* openDocument(const char* text, size_t length) {
+    SqlDocument* document = compilerAlloc(sizeof(SqlDocument));
+    if (!document) {
+        return NULL;
+    }
+    memset(document, 0, sizeof(*document));
+    document->text = compilerAlloc(length + 1);
+    if (!document->text) {
+        compilerFree(document, sizeof(SqlDocument));
+        return NULL;
+    }
+    memcpy(document->text, text, length);
+    document->text[length] = '\0';
+    document->length = length;
+
+    size_t position = 0;
+    do {
+        if (!reserveStatements(document, document->count + 1)) {
+            closeDocument(document);
+            return NULL;
+        }
+        StatementView* view = &document->statements[document->count];
+        size_t start = position;
+        position = scanStatement(document->text, length, start, view);
+        checkStatement(document->text + start, view);
+        document->count++;
+    } while (position < length);
+
+    document->rechecked = document->count;
+    return document;
+}
+
+// Splices the edit into the text and rescans from the first statement it
+// touches until a boundary lines up with an old one past the edit. Only the
+// rescanned statements are checked again; every other view, with its
+// diagnostic, is reused as is.
+bool applyEdit(SqlDocument* document, size_t offset, size_t removed,
+               const char* inserted, size_t insertedLength) {
+    if (offset > document->length || removed > document->length - offset) {
+        return false;
+    }
+
+    size_t length = document->length - removed + insertedLength;
+    char* text = compilerAlloc(length + 1);
+    if (!text) {
+        return false;
+    }
+    memcpy(text, document->text, offset);
+    memcpy(text + offset, inserted, insertedLength);
+    memcpy(text + offset + insertedLength, document->text + offset + removed,
+           document->length - offset - removed);
+    text[length] = '\0';
+
+    int first = 0;
+    size_t start = 0;
+    while (first < document->count - 1 && start + document->statements[first].length <= offset) {
+        start += document->statements[first].length;
+        first++;
+    }
+
+    // Old boundaries map into the new text only past the removed range
+    size_t oldEditEnd = offset + removed;
+    size_t newEditEnd = offset + insertedLength;
+    int last = first;
+    size_t oldEnd = start + document->statements[first].length;
+
+    StatementView* views = NULL;
+    int viewCount = 0;
+    int viewCapacity = 0;
+    size_t position = start;
+    bool resynced = false;
+    do {
+        if (viewCount == viewCapacity) {
+            int capacity = viewCapacity ? viewCapacity * 2 : 4;
+            StatementView* grown = compilerRealloc(views, sizeof(StatementView) * viewCapacity,
+                                                   sizeof(StatementView) * capacity);
+            if (!grown) {
+                compilerFree(views, sizeof(StatementView) * viewCapacity);
+                compilerFree(text, length + 1);
+                return false;
+            }
+            views = grown;
+            viewCapacity = capacity;
+        }
+        position = scanStatement(text, length, position, &views[viewCount++]);
+
+        if (position >= newEditEnd) {
+            while (last < document->count - 1 &&
+                   (oldEnd < oldEditEnd || oldEnd - removed + insertedLength < position)) {
+                last++;
+                oldEnd += document->statements[last].length;
+            }
+            resynced = oldEnd >= oldEditEnd && oldEnd - removed + insertedLength == position;
+        }
+    } while (!resynced && position < length);
+    if (!resynced) {
+        last = document->count - 1;
+    }
+
+    // Replace views [first, last] with the rescanned ones
+    int replaced = last - first + 1;
+    if (!reserveStatements(document, document->count - replaced + viewCount)) {
+        compilerFree(views, sizeof(StatementView) * viewCapacity);
+        compilerFree(text, length + 1);
+        return false;
+    }
+    memmove(&document->statements[first + viewCount], &document->statements[last + 1],
+            sizeof(StatementView) * (document->count - last - 1));
+    document->count += viewCount - replaced;
+
+    compilerFree(document->text, document->length + 1);
+    document->text = text;
+    document->length = length;
+
+    size_t viewStart = start;
+    for (int i = 0; i < viewCount; i++) {
+        document->statements[first + i] = views[i];
+        checkStatement(text + viewStart, &document->statements[first + i]);
+        viewStart += views[i].length;
+    }
+    compilerFree(views, sizeof(StatementView) * viewCapacity);
+
+    document->rechecked = viewCount;
+    return true;
+}
+
+// Prints the first error of every failing statement with document
+// positions and returns how many statements failed
+int printDocumentDiagnostics(const SqlDocument* document) {
+    int line = 1, column = 1;
+    int failed = 0;
+
+    for (int i = 0; i < document->count; i++) {
+        const StatementView* view = &document->statements[i];
+        const StatementDiagnostic* diagnostic = &view->diagnostic;
+        if (!diagnostic->ok) {
+            int errorLine = diagnostic->line > 0 ? line + diagnostic->line - 1 : line;
+            int errorColumn = diagnostic->line == 1 ? column + diagnostic->column - 1
+                                                    : diagnostic->column;
+            if (isTextOutput()) {
+                fprintf(compilerOutput, "Erro %s na linha %d, coluna %d: %s\n",
+                       DiagnosticPhaseLabels[diagnostic->phase], errorLine, errorColumn,
+                       diagnostic->message);
+            }
+            reportDiagnostic(CompilePhaseNames[diagnostic->phase], errorLine, errorColumn,
+                             diagnostic->message);
+            failed++;
+        }
+
+        line += view->newlines;
+        column = view->newlines > 0 ? view->lastLineLength + 1 : column + view->lastLineLength;
+    }
+    return failed;
+}
+
+void closeDocument(SqlDocument* document) {
+    compilerFree(document->statements, sizeof(StatementView) * document->capacity);
+    compilerFree(document->text, document->length + 1);
+    compilerFree(document, sizeof(SqlDocument));
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Edits are given as OFFSET,REMOVED,TEXT; TEXT accepts \n and \\ escapes
+static bool parseEdit(const char* spec, size_t* offset, size_t* removed, char* inserted,
+                      size_t* insertedLength) {
+    char* end;
+    *offset = strtoul(spec, &end, 10);
+    if (end == spec || *end != ',') {
+        return false;
+    }
+    const char* next = end + 1;
+    *removed = strtoul(next, &end, 10);
+    if (end == next || *end != ',') {
+        return false;
+    }
+
+    size_t length = 0;
+    for (const char* c = end + 1; *c; c++) {
+        if (c[0] == '\\' && c[1] == 'n') {
+            inserted[length++] = '\n';
+            c++;
+        } else if (c[0] == '\\' && c[1] == '\\') {
+            inserted[length++] = '\\';
+            c++;
+        } else {
+            inserted[length++] = *c;
+        }
+    }
+    *insertedLength = length;
+    return true;
+}
+
+static char* readWholeFile(const char* filename, size_t* length) {
+    FILE* input = fopen(filename, "rb");
+    if (!input) {
+        return NULL;
+    }
+    char* text = NULL;
+    size_t size = 0;
+    if (fseek(input, 0, SEEK_END) == 0) {
+        long end = ftell(input);
+        if (end >= 0 && fseek(input, 0, SEEK_SET) == 0) {
+            size = (size_t)end;
+            text = malloc(size + 1);
+            if (text && fread(text, 1, size, input) != size) {
+                free(text);
+                text = NULL;
+            }
+        }
+    }
+    fclose(input);
+    *length = size;
+    return text;
+}
+
+// Opens the file as a document, applies the edits in order and reports
+// how much each one had to recheck, then the remaining errors
+int runIncrementalCheck(const char* filename, const char** edits, int editCount) {
+    size_t length;
+    char* text = readWholeFile(filename, &length);
+    if (!text) {
+        printf("Erro: Não foi possível abrir o arquivo '%s'\n", filename);
+        return 1;
+    }
+
+    double started = now();
+    SqlDocument* document = openDocument(text, length);
+    free(text);
+    if (!document) {
+        printf("Erro: memória insuficiente para o documento '%s'\n", filename);
+        return 1;
+    }
+    if (shouldPrint(VERBOSITY_NORMAL)) {
+        fprintf(compilerOutput, "Documento %s: %d instrução(ões) analisada(s) em %.3f ms\n",
+               filename, document->count, (now() - started) * 1000.0);
+    }
+
+    int status = 0;
+    for (int i = 0; i < editCount; i++) {
+        size_t offset, removed, insertedLength;
+        char* inserted = malloc(strlen(edits[i]) + 1);
+        if (!inserted || !parseEdit(edits[i], &offset, &removed, inserted, &insertedLength)) {
+            printf("Erro: edição inválida: '%s'\n", edits[i]);
+            free(inserted);
+            status = 1;
+            break;
+        }
+
+        started = now();
+        bool applied = applyEdit(document, offset, removed, inserted, insertedLength);
+        free(inserted);
+        if (!applied) {
+            printf("Erro: edição fora do documento: '%s'\n", edits[i]);
+            status = 1;
+            break;
+        }
+        if (shouldPrint(VERBOSITY_NORMAL)) {
+            fprintf(compilerOutput, "Edição %d: %d de %d instrução(ões) reanalisada(s) em %.3f ms\n",
+                   i + 1, document->rechecked, document->count, (now() - started) * 1000.0);
+        }
+    }
+
+    if (printDocumentDiagnostics(document) > 0) {
+        status = 1;
+    }
+    closeDocument(document);
+    return status;
+}
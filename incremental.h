@@ -0,0 +1,45 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+#include "stats.h"
+
+// First error of a statement; line and column are relative to its start
+typedef struct {
+    bool ok;
+    CompilePhase phase;
+    int line;
+    int column;
+    char message[MAX_ERROR_LENGTH];
+} StatementDiagnostic;
+
+// One statement of a document: its bytes up to and including the ';'.
+// Views tile the text, so offsets and line numbers are prefix sums and an
+// edit never renumbers the statements after it.
+typedef struct {
+    size_t length;
+    int newlines;
+    int lastLineLength;     // Bytes after the last newline
+    StatementDiagnostic diagnostic;
+} StatementView;
+
+// SQL text kept open across edits, e.g. by an editor integration
+typedef struct {
+    char* text;
+    size_t length;
+    StatementView* statements;
+    int count;
+    int capacity;
+    int rechecked;          // Statements analyzed by the last open or edit
+} SqlDocument;
+
+SqlDocument* openDocument(const char* text, size_t length);
+bool applyEdit(SqlDocument* document, size_t offset, size_t removed,
+               const char* inserted, size_t insertedLength);
+int printDocumentDiagnostics(const SqlDocument* document);
+void closeDocument(SqlDocument* document);
+int runIncrementalCheck(const char* filename, const char** edits, int editCount);
+
+#endif
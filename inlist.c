@@ -0,0 +1,297 @@
+#include "inlist.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "allocator.h"
+
+const char* ProbeStrategyNames[] = {
+    "sorted array",
+    "hash set"
+};
+
+// A literal converted to the list's type
+typedef struct {
+    long long integer;
+    double real;
+    const char* string;
+} ConstantKey;
+
+static size_t valueSize(DataType type) {
+    switch (type) {
+        case TYPE_INT:   return sizeof(long long);
+        case TYPE_FLOAT: return sizeof(double);
+        default:         return sizeof(char*);
+    }
+}
+
+ConstantList* createConstantList(DataType type, int capacity, size_t textSize) {
+    ConstantList* list = compilerAlloc(sizeof(ConstantList));
+    if (!list) {
+        return NULL;
+    }
+    memset(list, 0, sizeof(*list));
+    list->type = type;
+    list->capacity = capacity;
+
+    list->values = compilerAlloc(valueSize(type) * capacity);
+    list->textSize = type == TYPE_VARCHAR ? textSize : 0;
+    list->text = list->textSize > 0 ? compilerAlloc(list->textSize) : NULL;
+    if (!list->values || (list->textSize > 0 && !list->text)) {
+        freeConstantList(list);
+        return NULL;
+    }
+    return list;
+}
+
+// Reads a literal as the list's type. String contents are copied to
+// content, without the quotes.
+static bool parseConstant(DataType type, const char* literal, ConstantKey* key, char* content) {
+    char* end;
+    errno = 0;
+
+    switch (type) {
+        case TYPE_INT: {
+            key->integer = strtoll(literal, &end, 10);
+            if (*end == '\0' && errno == 0) {
+                return true;
+            }
+            // 3.0 still matches 3
+            double real = strtod(literal, &end);
+            if (*end != '\0' || real != floor(real) || fabs(real) >= 9.2e18) {
+                return false;
+            }
+            key->integer = (long long)real;
+            return true;
+        }
+        case TYPE_FLOAT:
+            key->real = strtod(literal, &end);
+            if (key->real == 0) {
+                key->real = 0;  // -0.0 and 0.0 are the same value
+            }
+            return *end == '\0' && errno == 0;
+        case TYPE_VARCHAR: {
+            size_t length = strlen(literal);
+            if (length < 2 || (literal[0] != '\'' && literal[0] != '"') ||
+                literal[length - 1] != literal[0] || length - 2 >= MAX_TOKEN_LENGTH) {
+                return false;
+            }
+            memcpy(content, literal + 1, length - 2);
+            content[length - 2] = '\0';
+            key->string = content;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool addConstant(ConstantList* list, const char* literal) {
+    ConstantKey key = {0, 0, NULL};
+    char content[MAX_TOKEN_LENGTH];
+    if (list->count >= list->capacity || !parseConstant(list->type, literal, &key, content)) {
+        return false;
+    }
+
+    switch (list->type) {
+        case TYPE_INT:
+            ((long long*)list->values)[list->count++] = key.integer;
+            break;
+        case TYPE_FLOAT:
+            ((double*)list->values)[list->count++] = key.real;
+            break;
+        default: {
+            size_t length = strlen(content) + 1;
+            if (list->textLength + length > list->textSize) {
+                return false;
+            }
+            char* copy = list->text + list->textLength;
+            memcpy(copy, content, length);
+            list->textLength += length;
+            ((char**)list->values)[list->count++] = copy;
+            break;
+        }
+    }
+    return true;
+}
+
+static int compareIntegers(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+static int compareFloats(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int compareStrings(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Order of value index against key, as the sort left them
+static int compareKey(const ConstantList* list, int index, const ConstantKey* key) {
+    switch (list->type) {
+        case TYPE_INT:
+            return compareIntegers((long long*)list->values + index, &key->integer);
+        case TYPE_FLOAT:
+            return compareFloats((double*)list->values + index, &key->real);
+        default:
+            return strcmp(((char**)list->values)[index], key->string);
+    }
+}
+
+static unsigned long long mixBits(unsigned long long x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static unsigned long long hashKey(DataType type, const ConstantKey* key) {
+    switch (type) {
+        case TYPE_INT:
+            return mixBits((unsigned long long)key->integer);
+        case TYPE_FLOAT: {
+            unsigned long long bits;
+            memcpy(&bits, &key->real, sizeof(bits));
+            return mixBits(bits);
+        }
+        default: {
+            unsigned long long hash = 1469598103934665603ULL;
+            for (const unsigned char* c = (const unsigned char*)key->string; *c; c++) {
+                hash = (hash ^ *c) * 1099511628211ULL;
+            }
+            return hash;
+        }
+    }
+}
+
+static ConstantKey keyAt(const ConstantList* list, int index) {
+    ConstantKey key = {0, 0, NULL};
+    switch (list->type) {
+        case TYPE_INT:   key.integer = ((long long*)list->values)[index]; break;
+        case TYPE_FLOAT: key.real = ((double*)list->values)[index]; break;
+        default:         key.string = ((char**)list->values)[index]; break;
+    }
+    return key;
+}
+
+// Sorts and deduplicates the values, then picks the probe: binary search
+// stays within a few cache lines for short lists, longer ones get a hash
+// set at most half full
+bool finishConstantList(ConstantList* list) {
+    int (*compare)(const void*, const void*) =
+        list->type == TYPE_INT ? compareIntegers :
+        list->type == TYPE_FLOAT ? compareFloats : compareStrings;
+    size_t size = valueSize(list->type);
+    char* values = list->values;
+    qsort(values, list->count, size, compare);
+
+    int distinct = 0;
+    for (int i = 0; i < list->count; i++) {
+        if (distinct == 0 || compare(values + (distinct - 1) * size, values + i * size) != 0) {
+            memmove(values + distinct * size, values + i * size, size);
+            distinct++;
+        }
+    }
+    list->count = distinct;
+
+    if (list->count <= IN_LIST_HASH_THRESHOLD) {
+        list->probe = PROBE_SORTED;
+        return true;
+    }
+
+    unsigned int slotCount = 16;
+    while (slotCount < (unsigned int)list->count * 2) {
+        slotCount *= 2;
+    }
+    list->slots = compilerAlloc(sizeof(unsigned int) * slotCount);
+    if (!list->slots) {
+        return false;
+    }
+    memset(list->slots, 0, sizeof(unsigned int) * slotCount);
+    list->slotCount = slotCount;
+    list->probe = PROBE_HASH;
+
+    unsigned int mask = slotCount - 1;
+    for (int i = 0; i < list->count; i++) {
+        ConstantKey key = keyAt(list, i);
+        unsigned int slot = (unsigned int)hashKey(list->type, &key) & mask;
+        while (list->slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        list->slots[slot] = (unsigned int)i + 1;
+    }
+    return true;
+}
+
+static bool containsKey(const ConstantList* list, const ConstantKey* key) {
+    if (list->probe == PROBE_HASH) {
+        unsigned int mask = list->slotCount - 1;
+        for (unsigned int slot = (unsigned int)hashKey(list->type, key) & mask;
+             list->slots[slot] != 0; slot = (slot + 1) & mask) {
+            if (compareKey(list, (int)list->slots[slot] - 1, key) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int low = 0, high = list->count - 1;
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        int order = compareKey(list, middle, key);
+        if (order == 0) {
+            return true;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return false;
+}
+
+// Membership tests an executor runs per row, on values it already holds.
+// Numbers compare across INT and FLOAT lists; strings only match strings.
+bool constantListContainsInteger(const ConstantList* list, long long value) {
+    if (list->type == TYPE_FLOAT) {
+        return constantListContainsReal(list, (double)value);
+    }
+    ConstantKey key = {value, 0, NULL};
+    return list->type == TYPE_INT && containsKey(list, &key);
+}
+
+bool constantListContainsReal(const ConstantList* list, double value) {
+    if (isnan(value)) {
+        return false;
+    }
+    ConstantKey key = {0, value == 0 ? 0 : value, NULL};  // -0.0 is 0.0
+    if (list->type == TYPE_INT) {
+        if (value != floor(value) || fabs(value) >= 9.2e18) {
+            return false;
+        }
+        key.integer = (long long)value;
+        return containsKey(list, &key);
+    }
+    return list->type == TYPE_FLOAT && containsKey(list, &key);
+}
+
+bool constantListContainsString(const ConstantList* list, const char* value) {
+    ConstantKey key = {0, 0, value};
+    return list->type == TYPE_VARCHAR && containsKey(list, &key);
+}
+
+void freeConstantList(ConstantList* list) {
+    if (!list) {
+        return;
+    }
+    compilerFree(list->values, valueSize(list->type) * list->capacity);
+    compilerFree(list->text, list->textSize);
+    compilerFree(list->slots, sizeof(unsigned int) * list->slotCount);
+    compilerFree(list, sizeof(ConstantList));
+}
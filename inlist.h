@@ -0,0 +1,40 @@
+#ifndef INLIST_H
+#define INLIST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+
+#define IN_LIST_HASH_THRESHOLD 64   // Longer lists are probed through a hash set
+
+// How a row value is looked up in the list
+typedef enum {
+    PROBE_SORTED,   // Binary search, O(log n)
+    PROBE_HASH      // Open addressing, O(1)
+} ProbeStrategy;
+
+// Constants of one IN list as a typed array, sorted and without duplicates
+typedef struct {
+    DataType type;          // TYPE_INT, TYPE_FLOAT or TYPE_VARCHAR
+    ProbeStrategy probe;
+    int count;
+    int capacity;
+    void* values;           // long long, double or char* (into text) elements
+    char* text;             // String contents, NUL separated
+    size_t textSize;
+    size_t textLength;
+    unsigned int* slots;    // Hash set of value index + 1, 0 when empty
+    unsigned int slotCount;
+} ConstantList;
+
+extern const char* ProbeStrategyNames[];
+
+ConstantList* createConstantList(DataType type, int capacity, size_t textSize);
+bool addConstant(ConstantList* list, const char* literal);
+bool finishConstantList(ConstantList* list);
+bool constantListContainsInteger(const ConstantList* list, long long value);
+bool constantListContainsReal(const ConstantList* list, double value);
+bool constantListContainsString(const ConstantList* list, const char* value);
+void freeConstantList(ConstantList* list);
+
+#endif
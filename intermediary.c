@@ -1,7 +1,13 @@
 #include "intermediary.h"
+#include "output.h"
 
 IntermediateCodeContext intermediateCodeContext;
 
+const char *IntermediateCodeTypeNames[] = {
+    "LOAD", "FROM", "SELECT", "AS", "CONDITIONS", "PROJECT", "AGGREGATE",
+    "GROUP_BY", "JOIN", "ORDER_BY", "CONST", "ASSIGNMENT", "ARITHMETIC",
+    "RETURN", "CONCAT", "BETWEEN", "HAVING", "LIMIT", "TOP_N", "ANALYZE"};
+
 void initIntermediateCodeContext()
 {
   intermediateCodeContext.instructionCount = 0;
@@ -25,7 +31,11 @@ void addIntermediateCodeInstruction(
 {
   if (intermediateCodeContext.instructionCount >= MAX_INTERMEDIATE_CODE)
   {
-    printf("Error: Intermediate code buffer overflow\n");
+    if (isTextOutput())
+    {
+      fprintf(compilerOutput, "Error: Intermediate code buffer overflow\n");
+    }
+    reportDiagnostic("intermediate", 0, 0, "Intermediate code buffer overflow");
     return;
   }
 
@@ -41,8 +51,8 @@ void addIntermediateCodeInstruction(
 
 void printIntermediateCode()
 {
-  printf("Intermediate Code Generation:\n");
-  printf("-----------------------------\n");
+  fprintf(compilerOutput, "Intermediate Code Generation:\n");
+  fprintf(compilerOutput, "-----------------------------\n");
 
   for (int i = 0; i < intermediateCodeContext.instructionCount; i++)
   {
@@ -52,70 +62,381 @@ void printIntermediateCode()
     switch (instr->type)
     {
     case IR_LOAD:
-      printf("%s = LOAD %s\n", instr->result, instr->op1);
+      fprintf(compilerOutput, "%s = LOAD %s\n", instr->result, instr->op1);
       break;
     case IR_FROM:
-      printf("%s = %s FROM %s\n", instr->result, instr->op1, instr->op2);
+      fprintf(compilerOutput, "%s = %s FROM %s\n", instr->result, instr->op1, instr->op2);
       break;
     case IR_SELECT:
-      printf("%s = SELECT %s\n",
+      fprintf(compilerOutput, "%s = SELECT %s\n",
              instr->result, instr->op1);
       break;
     case IR_AS:
-      printf("%s = %s AS %s\n",
+      fprintf(compilerOutput, "%s = %s AS %s\n",
              instr->result, instr->op1, instr->op2);
       break;
     case IR_CONDITIONS:
-      printf("%s = %s%s %s\n",
+      fprintf(compilerOutput, "%s = %s%s %s\n",
              instr->result, instr->op1, instr->operation, instr->op2);
       break;
     case IR_PROJECT:
-      printf("%s = PROJECT %s (%s)\n",
+      fprintf(compilerOutput, "%s = PROJECT %s (%s)\n",
              instr->result, instr->op1, instr->op2);
       break;
     case IR_AGGREGATE:
-      printf("%s = %s(%s)\n",
+      fprintf(compilerOutput, "%s = %s(%s)\n",
              instr->result, instr->operation, instr->op1);
       break;
     case IR_GROUP_BY:
-      printf("%s = GROUP %s BY %s\n",
+      fprintf(compilerOutput, "%s = GROUP %s BY %s\n",
              instr->result, instr->op1, instr->op2);
       break;
     case IR_JOIN:
-      printf("%s = JOIN %s ON %s\n",
+      fprintf(compilerOutput, "%s = JOIN %s ON %s\n",
              instr->result, instr->op1, instr->op2);
       break;
     case IR_ORDER_BY:
-      printf("%s = ORDER %s BY %s\n",
+      fprintf(compilerOutput, "%s = ORDER %s BY %s\n",
              instr->result, instr->op1, instr->op2);
       break;
     case IR_CONST:
-      printf("%s = CONST %s\n", instr->result, instr->op1);
+      fprintf(compilerOutput, "%s = CONST %s\n", instr->result, instr->op1);
       break;
     case IR_ASSIGNMENT:
-      printf("%s = %s\n", instr->result, instr->op1);
+      fprintf(compilerOutput, "%s = %s\n", instr->result, instr->op1);
       break;
     case IR_ARITHMETIC:
-      printf("%s = %s %s %s\n",
+      fprintf(compilerOutput, "%s = %s %s %s\n",
              instr->result, instr->op1, instr->operation, instr->op2);
       break;
     case IR_RETURN:
-      printf("RETURN %s\n", instr->result);
+      fprintf(compilerOutput, "RETURN %s\n", instr->result);
       break;
     case IR_CONCAT:
-      printf("%s = %s %s\n", instr->result, instr->op1, instr->op2);
+      fprintf(compilerOutput, "%s = %s %s\n", instr->result, instr->op1, instr->op2);
       break;
     case IR_BETWEEN:
-      printf("%s = %s BETWEEN %s\n",
+      fprintf(compilerOutput, "%s = %s BETWEEN %s\n",
              instr->result, instr->op1, instr->op2);
       break;
     case IR_HAVING:
-      printf("%s = HAVING %s\n", instr->result, instr->operation);
+      fprintf(compilerOutput, "%s = HAVING %s\n", instr->result, instr->operation);
+      break;
+    case IR_LIMIT:
+      if (instr->operation[0] != '\0')
+      {
+        fprintf(compilerOutput, "%s = LIMIT %s %s OFFSET %s\n",
+               instr->result, instr->op1, instr->op2, instr->operation);
+      }
+      else
+      {
+        fprintf(compilerOutput, "%s = LIMIT %s %s\n", instr->result, instr->op1, instr->op2);
+      }
+      break;
+    case IR_ANALYZE:
+      if (instr->op2[0] != '\0')
+      {
+        fprintf(compilerOutput, "%s = ANALYZE %s (%s)\n", instr->result, instr->op1, instr->op2);
+      }
+      else
+      {
+        fprintf(compilerOutput, "%s = ANALYZE %s\n", instr->result, instr->op1);
+      }
       break;
+    case IR_TOP_N:
+      fprintf(compilerOutput, "%s = TOP %s %s BY %s\n",
+             instr->result, instr->operation, instr->op1, instr->op2);
+      break;
+    }
+  }
+}
+
+// Reads "LIMIT n [OFFSET m]" starting at the LIMIT keyword, leaving current
+// on the last token consumed. Returns false when no row count follows. The
+// parser has already bounded both counts and their sum to LLONG_MAX.
+static bool readLimitClause(TokenBuffer *buffer, int *current,
+                            char *limit, char *offset)
+{
+  if (*current + 1 >= buffer->count ||
+      buffer->tokens[*current + 1].type != TOKEN_INTEGER)
+  {
+    return false;
+  }
+  (*current)++;
+  strncpy(limit, buffer->tokens[*current].value, MAX_OPERATOR_LENGTH - 1);
+  limit[MAX_OPERATOR_LENGTH - 1] = '\0';
+  offset[0] = '\0';
+
+  if (*current + 2 < buffer->count &&
+      strcmp(buffer->tokens[*current + 1].value, "OFFSET") == 0 &&
+      buffer->tokens[*current + 2].type == TOKEN_INTEGER)
+  {
+    *current += 2;
+    strncpy(offset, buffer->tokens[*current].value, MAX_OPERATOR_LENGTH - 1);
+    offset[MAX_OPERATOR_LENGTH - 1] = '\0';
+  }
+  return true;
+}
+
+// Reads "( value, ... )" of an IN predicate into predicate->value, leaving
+// current after the closing parenthesis. A normalized list is a single
+// "$n" slot; a raw one is spelled out while it fits an operand.
+static void readInList(TokenBuffer *buffer, int *current, FilterPredicate *predicate)
+{
+  char values[MAX_OPERAND_LENGTH] = "(";
+  int count = 0;
+  bool fits = true;
+
+  predicate->valueType = TOKEN_EOF;
+  if (*current < buffer->count && strcmp(buffer->tokens[*current].value, "(") == 0)
+  {
+    (*current)++;
+  }
+
+  while (*current < buffer->count &&
+         strcmp(buffer->tokens[*current].value, ")") != 0 &&
+         buffer->tokens[*current].type != TOKEN_SEMICOLON &&
+         buffer->tokens[*current].type != TOKEN_EOF)
+  {
+    const Token *token = &buffer->tokens[*current];
+    if (strcmp(token->value, ",") != 0)
+    {
+      if (count == 0)
+      {
+        predicate->valueType = token->type;
+      }
+      if (strlen(values) + strlen(token->value) + 3 < MAX_OPERAND_LENGTH)
+      {
+        if (count > 0)
+        {
+          strcat(values, ", ");
+        }
+        strcat(values, token->value);
+      }
+      else
+      {
+        fits = false;
+      }
+      count++;
+    }
+    (*current)++;
+  }
+  if (*current < buffer->count && strcmp(buffer->tokens[*current].value, ")") == 0)
+  {
+    (*current)++;
+  }
+
+  if (fits)
+  {
+    snprintf(predicate->value, sizeof(predicate->value), "%s)", values);
+  }
+  else
+  {
+    snprintf(predicate->value, sizeof(predicate->value), "(%d values)", count);
+  }
+}
+
+// Emits one WHERE predicate and stores the temp holding its result
+static void generateFilterPredicate(const FilterPredicate *predicate, char *result)
+{
+  if (strcmp(predicate->operation, "BETWEEN") == 0)
+  {
+    char bounds[MAX_OPERAND_LENGTH];
+    strcpy(bounds, generateTempVar());
+    addIntermediateCodeInstruction(
+        IR_ARITHMETIC,
+        bounds,
+        predicate->value,
+        predicate->upperValue,
+        "AND");
+
+    strcpy(result, generateTempVar());
+    addIntermediateCodeInstruction(
+        IR_BETWEEN,
+        result,
+        predicate->column,
+        bounds,
+        NULL);
+  }
+  else
+  {
+    strcpy(result, generateTempVar());
+    addIntermediateCodeInstruction(
+        IR_ARITHMETIC,
+        result,
+        predicate->column,
+        predicate->value,
+        predicate->operation);
+  }
+}
+
+// Combines two condition temps with AND/OR into result
+static void combineConditions(char *result, const char *left,
+                              const char *right, const char *operation)
+{
+  char *tempVar = generateTempVar();
+  addIntermediateCodeInstruction(
+      IR_CONDITIONS,
+      tempVar,
+      left,
+      right,
+      operation);
+  strcpy(result, tempVar);
+}
+
+// Fraction of rows expected to pass a comparison, from the operator alone
+double estimateOperatorSelectivity(const char *operation)
+{
+  if (strcmp(operation, "=") == 0)
+  {
+    return 0.1;
+  }
+  if (strcmp(operation, "<>") == 0 || strcmp(operation, "!=") == 0)
+  {
+    return 0.9;
+  }
+  if (strcmp(operation, "BETWEEN") == 0)
+  {
+    return 0.25;
+  }
+  // List length is only known once the values are bound
+  if (strcmp(operation, "IN") == 0)
+  {
+    return 0.2;
+  }
+  if (strcmp(operation, "NOT IN") == 0)
+  {
+    return 0.8;
+  }
+  if (strcmp(operation, "<") == 0 || strcmp(operation, ">") == 0 ||
+      strcmp(operation, "<=") == 0 || strcmp(operation, ">=") == 0)
+  {
+    return 0.33;
+  }
+  return 0.5;
+}
+
+static double estimatePredicateSelectivity(const FilterPredicate *predicate)
+{
+  return estimateOperatorSelectivity(predicate->operation);
+}
+
+// Relative cost of evaluating a predicate on one row: numeric comparisons
+// are cheapest. Literals are parameter slots by now, so their length is not
+// known here.
+static double estimatePredicateCost(const FilterPredicate *predicate)
+{
+  double cost;
+
+  switch (predicate->valueType)
+  {
+  case TOKEN_INTEGER:
+  case TOKEN_FLOAT:
+    cost = 1.0;
+    break;
+  case TOKEN_STRING:
+    cost = 3.0;
+    break;
+  default:
+    cost = 2.0;
+    break;
+  }
+
+  // A range or set probe costs about two comparisons
+  if (strcmp(predicate->operation, "BETWEEN") == 0 ||
+      strcmp(predicate->operation, "IN") == 0 ||
+      strcmp(predicate->operation, "NOT IN") == 0)
+  {
+    cost *= 2.0;
+  }
+  return cost;
+}
+
+// Predicates that are cheap and reject many rows should run first, so the
+// rank is cost per rejected row
+static double predicateRank(const FilterPredicate *predicate)
+{
+  double selectivity = estimatePredicateSelectivity(predicate);
+  return estimatePredicateCost(predicate) / (1.0 - selectivity + 0.001);
+}
+
+// Reorders the predicates of each AND group by rank. OR groups keep their
+// source order, since only conjuncts can be evaluated on surviving rows.
+static void reorderConjuncts(FilterPredicate *predicates, int count)
+{
+  int groupStart = 0;
+
+  while (groupStart < count)
+  {
+    int groupEnd = groupStart + 1;
+    while (groupEnd < count && !predicates[groupEnd].startsGroup)
+    {
+      groupEnd++;
     }
+
+    // Stable insertion sort keeps source order between equal ranks
+    for (int i = groupStart + 1; i < groupEnd; i++)
+    {
+      FilterPredicate predicate = predicates[i];
+      double rank = predicateRank(&predicate);
+      int j = i - 1;
+      while (j >= groupStart && predicateRank(&predicates[j]) > rank)
+      {
+        predicates[j + 1] = predicates[j];
+        j--;
+      }
+      predicates[j + 1] = predicate;
+    }
+
+    for (int i = groupStart; i < groupEnd; i++)
+    {
+      predicates[i].startsGroup = (i == groupStart);
+    }
+    groupStart = groupEnd;
   }
 }
 
+// Emits a WHERE clause as OR-ed groups of AND-ed predicates, which gives
+// AND its usual higher precedence
+static void generateFilterCode(FilterPredicate *predicates, int count, char *result)
+{
+  char orResult[MAX_OPERAND_LENGTH] = "";
+  char andResult[MAX_OPERAND_LENGTH] = "";
+
+  reorderConjuncts(predicates, count);
+
+  for (int i = 0; i < count; i++)
+  {
+    char predicateResult[MAX_OPERAND_LENGTH];
+    generateFilterPredicate(&predicates[i], predicateResult);
+
+    if (andResult[0] == '\0')
+    {
+      strcpy(andResult, predicateResult);
+    }
+    else
+    {
+      combineConditions(andResult, andResult, predicateResult, " AND");
+    }
+
+    // Close the group before the next OR
+    if (i + 1 == count || predicates[i + 1].startsGroup)
+    {
+      if (orResult[0] == '\0')
+      {
+        strcpy(orResult, andResult);
+      }
+      else
+      {
+        combineConditions(orResult, orResult, andResult, " OR");
+      }
+      andResult[0] = '\0';
+    }
+  }
+
+  strcpy(result, orResult);
+}
+
 void generateIntermediateCode(TokenBuffer *buffer)
 {
 
@@ -123,12 +444,9 @@ void generateIntermediateCode(TokenBuffer *buffer)
 
   int current = 0;
   char *currentResult = NULL;
+  char filterResult[MAX_OPERAND_LENGTH] = "";
   bool hasGroupBy = false;
 
-  const char *aggregateFuncs[] = {
-      "COUNT", "SUM", "AVG", "MAX", "MIN"};
-  const int numAggregateFuncs = sizeof(aggregateFuncs) / sizeof(aggregateFuncs[0]);
-
   while (current < buffer->count)
   {
     Token token = buffer->tokens[current];
@@ -141,211 +459,165 @@ void generateIntermediateCode(TokenBuffer *buffer)
         current++;
 
         char projectionColumns[MAX_OPERAND_LENGTH] = "";
-        bool firstColumn = true;
-
-        bool isAggregate = false;
-        bool isAs = false;
-        bool isMultipleConditions = false;
         char previousResult[MAX_OPERAND_LENGTH] = "";
+        char projectionResult[MAX_OPERAND_LENGTH] = "";
+        bool hasPreviousResult = false;
 
-        currentResult = generateTempVar();
+        // Optional DISTINCT keyword
+        if (current < buffer->count &&
+            strcmp(buffer->tokens[current].value, "DISTINCT") == 0)
+        {
+          current++;
+        }
+
+        strcpy(projectionResult, generateTempVar());
+        int projectionIndex = intermediateCodeContext.instructionCount;
         addIntermediateCodeInstruction(
             IR_PROJECT,
-            currentResult,
+            projectionResult,
             "temp_table",
             projectionColumns,
             NULL);
 
-        for (int i = 0; i < numAggregateFuncs; i++)
-        {
-          if (strcmp(buffer->tokens[current].value, aggregateFuncs[i]) == 0)
-          {
-            isAggregate = true;
-          }
-        }
-
         while (current < buffer->count &&
-               ((buffer->tokens[current].type != TOKEN_KEYWORD) || isAggregate))
+               buffer->tokens[current].type != TOKEN_SEMICOLON &&
+               strcmp(buffer->tokens[current].value, "FROM") != 0)
         {
+          const char *itemName = buffer->tokens[current].value;
+          char itemResult[MAX_OPERAND_LENGTH] = "";
+          AggregateFunction aggregate = getAggregateFunction(itemName);
 
-          if (isAggregate)
+          if (aggregate != AGG_NONE)
           {
-            char aggregateOperand[MAX_OPERAND_LENGTH] = "";
-            strcpy(aggregateOperand, buffer->tokens[current].value);
+            // FUNC ( [DISTINCT] column | * )
+            char aggregateColumn[MAX_OPERAND_LENGTH] = "";
             current++;
 
             if (current < buffer->count &&
                 strcmp(buffer->tokens[current].value, "(") == 0)
             {
-              strcat(aggregateOperand, buffer->tokens[current].value);
               current++;
             }
 
             if (current < buffer->count &&
-                buffer->tokens[current].type == TOKEN_IDENTIFIER)
+                strcmp(buffer->tokens[current].value, "DISTINCT") == 0)
             {
-              strcat(aggregateOperand, buffer->tokens[current].value);
               current++;
             }
 
             if (current < buffer->count &&
-                strcmp(buffer->tokens[current].value, ")") == 0)
+                (buffer->tokens[current].type == TOKEN_IDENTIFIER ||
+                 strcmp(buffer->tokens[current].value, "*") == 0))
             {
-              strcat(aggregateOperand, buffer->tokens[current].value);
+              strcpy(aggregateColumn, buffer->tokens[current].value);
               current++;
             }
 
             if (current < buffer->count &&
-                strcmp(buffer->tokens[current].value, "AS") == 0)
+                strcmp(buffer->tokens[current].value, ")") == 0)
             {
               current++;
-              if (current < buffer->count &&
-                  buffer->tokens[current].type == TOKEN_IDENTIFIER)
-              {
-                currentResult = generateTempVar();
-                addIntermediateCodeInstruction(
-                    IR_AS,
-                    currentResult,
-                    aggregateOperand,
-                    buffer->tokens[current].value,
-                    NULL);
-              }
             }
+
+            strcpy(itemResult, generateTempVar());
+            addIntermediateCodeInstruction(
+                IR_AGGREGATE,
+                itemResult,
+                aggregateColumn,
+                NULL,
+                AggregateFunctionNames[aggregate]);
+          }
+          else if (buffer->tokens[current].type == TOKEN_IDENTIFIER ||
+                   strcmp(itemName, "*") == 0)
+          {
+            current++;
+          }
+          else
+          {
+            // Skip anything that is not a projection item
+            current++;
+            continue;
           }
-          else if (buffer->tokens[current].type == TOKEN_IDENTIFIER)
+
+          if (current < buffer->count &&
+              strcmp(buffer->tokens[current].value, "AS") == 0)
           {
             current++;
             if (current < buffer->count &&
-                strcmp(buffer->tokens[current].value, "AS") == 0)
-            {
-              current++;
-              isAs = true;
-              if (current < buffer->count &&
-                  buffer->tokens[current].type == TOKEN_IDENTIFIER)
-              {
-                currentResult = generateTempVar();
-                addIntermediateCodeInstruction(
-                    IR_AS,
-                    currentResult,
-                    buffer->tokens[current].value,
-                    buffer->tokens[current - 2].value,
-                    NULL);
-              }
-            }
-            else
+                buffer->tokens[current].type == TOKEN_IDENTIFIER)
             {
-              if (!firstColumn)
-              {
-                strcat(projectionColumns, ", ");
-              }
-              strcat(projectionColumns, buffer->tokens[current].value);
-              firstColumn = false;
+              char aliasSource[MAX_OPERAND_LENGTH];
+              strcpy(aliasSource, itemResult[0] != '\0' ? itemResult : itemName);
 
+              strcpy(itemResult, generateTempVar());
+              addIntermediateCodeInstruction(
+                  IR_AS,
+                  itemResult,
+                  aliasSource,
+                  buffer->tokens[current].value,
+                  NULL);
               current++;
             }
           }
 
-          if (buffer->count > current + 1 && strcmp(buffer->tokens[current + 1].value, "FROM") == 0)
+          if (itemResult[0] != '\0')
           {
-
-            if (isMultipleConditions && (isAs || isAggregate))
+            // Computed items are chained into a single result
+            if (hasPreviousResult)
             {
-              char current[100];
-              strcpy(current, currentResult);
-
               char *tempVar = generateTempVar();
-
               addIntermediateCodeInstruction(
                   IR_CONDITIONS,
                   tempVar,
                   previousResult,
-                  current,
+                  itemResult,
                   ",");
-
-              currentResult = tempVar;
+              strcpy(previousResult, tempVar);
+            }
+            else
+            {
+              strcpy(previousResult, itemResult);
+              hasPreviousResult = true;
             }
-            break;
-          }
-
-          current++;
-
-          if (isMultipleConditions && (isAs || isAggregate))
-          {
-            char current[100];
-            strcpy(current, currentResult);
-
-            char *tempVar = generateTempVar();
-
-            addIntermediateCodeInstruction(
-                IR_CONDITIONS,
-                tempVar,
-                previousResult,
-                current,
-                ",");
-
-            currentResult = tempVar;
           }
-
-          if (isAs || isAggregate)
+          else if (strlen(projectionColumns) + strlen(itemName) + 2 < MAX_OPERAND_LENGTH)
           {
-            strcpy(previousResult, currentResult);
-            isMultipleConditions = true;
+            if (projectionColumns[0] != '\0')
+            {
+              strcat(projectionColumns, ", ");
+            }
+            strcat(projectionColumns, itemName);
           }
 
-          isAs = false;
-          isAggregate = false;
-
-          for (int i = 0; i < numAggregateFuncs; i++)
+          if (current < buffer->count &&
+              strcmp(buffer->tokens[current].value, ",") == 0)
           {
-            if (strcmp(buffer->tokens[current].value, aggregateFuncs[i]) == 0)
-            {
-              isAggregate = true;
-            }
+            current++;
           }
         }
 
-        if (current < buffer->count &&
-            strcmp(buffer->tokens[current].value, "FROM") != 0)
+        // Plain columns are only known once the list has been read
+        if (projectionIndex < intermediateCodeContext.instructionCount)
         {
-
-          for (size_t i = 0; i < sizeof(aggregateFuncs) / sizeof(aggregateFuncs[0]); i++)
-          {
-            if (strcmp(buffer->tokens[current].value, aggregateFuncs[i]) == 0)
-            {
-              isAggregate = true;
-              current++;
-
-              if (current < buffer->count &&
-                  strcmp(buffer->tokens[current].value, "(") == 0)
-              {
-                current++;
-              }
-
-              if (current < buffer->count &&
-                  buffer->tokens[current].type == TOKEN_IDENTIFIER)
-              {
-                currentResult = generateTempVar();
-
-                addIntermediateCodeInstruction(
-                    IR_AGGREGATE,
-                    currentResult,
-                    buffer->tokens[current].value,
-                    NULL,
-                    aggregateFuncs[i]);
-                current++;
-              }
-
-              if (current < buffer->count &&
-                  strcmp(buffer->tokens[current].value, ")") == 0)
-              {
-                current++;
-              }
-              break;
-            }
-          }
+          snprintf(intermediateCodeContext.instructions[projectionIndex].op2,
+                   MAX_OPERAND_LENGTH, "%s", projectionColumns);
         }
 
-        strcpy(previousResult, currentResult);
+        if (!hasPreviousResult)
+        {
+          strcpy(previousResult, projectionResult);
+        }
+        else if (projectionColumns[0] != '\0')
+        {
+          char *tempVar = generateTempVar();
+          addIntermediateCodeInstruction(
+              IR_CONDITIONS,
+              tempVar,
+              projectionResult,
+              previousResult,
+              ",");
+          strcpy(previousResult, tempVar);
+        }
 
         currentResult = generateTempVar();
         addIntermediateCodeInstruction(
@@ -354,6 +626,9 @@ void generateIntermediateCode(TokenBuffer *buffer)
             previousResult,
             NULL,
             NULL);
+
+        // Leave FROM to the main loop
+        current--;
       }
       else if (strcmp(token.value, "FROM") == 0)
       {
@@ -416,70 +691,95 @@ void generateIntermediateCode(TokenBuffer *buffer)
                   table1,
                   previousResult,
                   NULL);
-
-              strcpy(previousResult, currentResult);
-              currentResult = generateTempVar();
             }
           }
         }
       }
       else if (strcmp(token.value, "WHERE") == 0)
       {
+        FilterPredicate predicates[MAX_CONDITIONS];
+        int predicateCount = 0;
+        bool startsGroup = true;
 
         current++;
 
-        while (current < buffer->count)
+        while (current < buffer->count &&
+               buffer->tokens[current].type == TOKEN_IDENTIFIER)
         {
-          if (buffer->tokens[current].type == TOKEN_IDENTIFIER)
-          {
+          FilterPredicate predicate;
+          strcpy(predicate.column, buffer->tokens[current].value);
+          predicate.upperValue[0] = '\0';
+          predicate.startsGroup = startsGroup;
+          current++;
 
-            current++;
+          if (current + 3 < buffer->count &&
+              strcmp(buffer->tokens[current].value, "BETWEEN") == 0 &&
+              strcmp(buffer->tokens[current + 2].value, "AND") == 0)
+          {
+            strcpy(predicate.operation, "BETWEEN");
+            strcpy(predicate.value, buffer->tokens[current + 1].value);
+            strcpy(predicate.upperValue, buffer->tokens[current + 3].value);
+            predicate.valueType = buffer->tokens[current + 1].type;
+            current += 4;
+          }
+          else if (current + 1 < buffer->count &&
+                   (strcmp(buffer->tokens[current].value, "IN") == 0 ||
+                    (strcmp(buffer->tokens[current].value, "NOT") == 0 &&
+                     strcmp(buffer->tokens[current + 1].value, "IN") == 0)))
+          {
+            bool negated = strcmp(buffer->tokens[current].value, "NOT") == 0;
+            strcpy(predicate.operation, negated ? "NOT IN" : "IN");
+            current += negated ? 2 : 1;
+            readInList(buffer, &current, &predicate);
+          }
+          else if (current + 1 < buffer->count &&
+                   buffer->tokens[current].type == TOKEN_OPERATOR)
+          {
+            strcpy(predicate.operation, buffer->tokens[current].value);
+            strcpy(predicate.value, buffer->tokens[current + 1].value);
+            predicate.valueType = buffer->tokens[current + 1].type;
+            current += 2;
+          }
+          else
+          {
+            break;
+          }
 
-            if (strcmp(buffer->tokens[current].value, "BETWEEN") == 0)
+          if (predicateCount < MAX_CONDITIONS)
+          {
+            predicates[predicateCount++] = predicate;
+          }
+          else
+          {
+            if (isTextOutput())
             {
-              current++;
-              char condition1[MAX_OPERAND_LENGTH] = "";
-              char condition2[MAX_OPERAND_LENGTH] = "";
-
-              if (buffer->tokens[current].type == TOKEN_STRING)
-              {
-                strcpy(condition1, buffer->tokens[current].value);
-                current++;
-              }
-
-              if (current < buffer->count && strcmp(buffer->tokens[current].value, "AND") == 0)
-              {
-                current++;
-                if (buffer->tokens[current].type == TOKEN_STRING)
-                {
-                  strcpy(condition2, buffer->tokens[current].value);
-
-                  addIntermediateCodeInstruction(
-                      IR_ARITHMETIC,
-                      currentResult,
-                      condition1,
-                      condition2,
-                      "AND");
-
-                  char previousResult[100];
-
-                  strcpy(previousResult, currentResult);
-
-                  currentResult = generateTempVar();
-
-                  addIntermediateCodeInstruction(
-                      IR_BETWEEN,
-                      currentResult,
-                      previousResult,
-                      currentResult,
-                      NULL);
-
-                  break;
-                }
-              }
+              fprintf(compilerOutput, "Error: Too many WHERE conditions (max %d)\n", MAX_CONDITIONS);
             }
+            reportDiagnostic("intermediate", token.line, token.column, "Too many WHERE conditions");
+          }
+
+          // AND continues the current group, OR starts a new one
+          if (current < buffer->count &&
+              (strcmp(buffer->tokens[current].value, "AND") == 0 ||
+               strcmp(buffer->tokens[current].value, "OR") == 0))
+          {
+            startsGroup = strcmp(buffer->tokens[current].value, "OR") == 0;
+            current++;
+          }
+          else
+          {
+            break;
           }
         }
+
+        if (predicateCount > 0)
+        {
+          generateFilterCode(predicates, predicateCount, filterResult);
+          currentResult = filterResult;
+        }
+
+        // Leave the clause that ended WHERE to the main loop
+        current--;
       }
       else if (strcmp(token.value, "GROUP") == 0)
       {
@@ -537,7 +837,11 @@ void generateIntermediateCode(TokenBuffer *buffer)
 
         if (!hasGroupBy)
         {
-          printf("Error: HAVING clause without GROUP BY\n");
+          if (isTextOutput())
+          {
+            fprintf(compilerOutput, "Error: HAVING clause without GROUP BY\n");
+          }
+          reportDiagnostic("intermediate", token.line, token.column, "HAVING clause without GROUP BY");
           break;
         }
 
@@ -550,33 +854,21 @@ void generateIntermediateCode(TokenBuffer *buffer)
         hasGroupBy = false;
         current++;
 
-        bool isAggregate = false;
-        for (int i = 0; i < numAggregateFuncs; i++)
-        {
-          if (strcmp(buffer->tokens[current].value, aggregateFuncs[i]) == 0)
-          {
-            isAggregate = true;
-          }
-        }
+        bool isAggregate = current < buffer->count &&
+                           getAggregateFunction(buffer->tokens[current].value) != AGG_NONE;
 
         while (current < buffer->count &&
+               buffer->tokens[current].type != TOKEN_SEMICOLON &&
                (buffer->tokens[current].type != TOKEN_KEYWORD || isAggregate))
         {
+          int start = current;
 
-          bool isAggregateFunc = false;
-          for (int i = 0; i < numAggregateFuncs; i++)
+          AggregateFunction aggregate = getAggregateFunction(buffer->tokens[current].value);
+          if (aggregate != AGG_NONE)
           {
-            if (strcmp(buffer->tokens[current].value, aggregateFuncs[i]) == 0)
-            {
-              isAggregateFunc = true;
-              strcpy(aggregateFunc, aggregateFuncs[i]);
-              current++;
-              break;
-            }
-          }
+            strcpy(aggregateFunc, AggregateFunctionNames[aggregate]);
+            current++;
 
-          if (isAggregateFunc)
-          {
 
             if (current < buffer->count &&
                 strcmp(buffer->tokens[current].value, "(") == 0)
@@ -598,33 +890,33 @@ void generateIntermediateCode(TokenBuffer *buffer)
             }
           }
 
-          if (strcmp(buffer->tokens[current].value, ">") == 0 ||
+          if (current < buffer->count &&
+              (strcmp(buffer->tokens[current].value, ">") == 0 ||
               strcmp(buffer->tokens[current].value, "<") == 0 ||
               strcmp(buffer->tokens[current].value, ">=") == 0 ||
               strcmp(buffer->tokens[current].value, "<=") == 0 ||
-              strcmp(buffer->tokens[current].value, "=") == 0)
+              strcmp(buffer->tokens[current].value, "=") == 0))
           {
             strcpy(havingOperator, buffer->tokens[current].value);
             current++;
 
             if (current < buffer->count &&
                 (buffer->tokens[current].type == TOKEN_FLOAT || buffer->tokens[current].type == TOKEN_INTEGER ||
-                 buffer->tokens[current].type == TOKEN_STRING))
+                 buffer->tokens[current].type == TOKEN_STRING || buffer->tokens[current].type == TOKEN_PARAMETER))
             {
               strcpy(havingValue, buffer->tokens[current].value);
               current++;
             }
           }
 
-          isAggregate = false;
-
-          for (int i = 0; i < numAggregateFuncs; i++)
+          // Skip tokens this clause does not understand
+          if (current == start)
           {
-            if (strcmp(buffer->tokens[current].value, aggregateFuncs[i]) == 0)
-            {
-              isAggregate = true;
-            }
+            current++;
           }
+
+          isAggregate = current < buffer->count &&
+                        getAggregateFunction(buffer->tokens[current].value) != AGG_NONE;
         }
 
         if (strlen(aggregateFunc) > 0 && strlen(aggregateOperand) > 0)
@@ -641,7 +933,7 @@ void generateIntermediateCode(TokenBuffer *buffer)
           strcat(havingCondition, " ");
           strcat(havingCondition, havingOperator);
           strcat(havingCondition, " ");
-          strcat(havingCondition, buffer->tokens[current - 1].value);
+          strcat(havingCondition, havingValue);
 
           char *havingResult = generateTempVar();
 
@@ -653,6 +945,190 @@ void generateIntermediateCode(TokenBuffer *buffer)
               havingCondition);
           currentResult = havingResult;
         }
+
+        // Leave the clause that ended HAVING to the main loop
+        if (current < buffer->count)
+        {
+          current--;
+        }
+      }
+      else if (strcmp(token.value, "ORDER") == 0)
+      {
+
+        current++;
+        if (current < buffer->count &&
+            strcmp(buffer->tokens[current].value, "BY") == 0)
+        {
+          current++;
+
+          char orderColumns[MAX_OPERAND_LENGTH] = "";
+
+          while (current < buffer->count &&
+                 buffer->tokens[current].type == TOKEN_IDENTIFIER)
+          {
+            const char *direction = NULL;
+            if (current + 1 < buffer->count)
+            {
+              if (strcasecmp(buffer->tokens[current + 1].value, "ASC") == 0)
+              {
+                direction = "ASC";
+              }
+              else if (strcasecmp(buffer->tokens[current + 1].value, "DESC") == 0)
+              {
+                direction = "DESC";
+              }
+            }
+
+            if (strlen(orderColumns) + strlen(buffer->tokens[current].value) + 8 < MAX_OPERAND_LENGTH)
+            {
+              if (orderColumns[0] != '\0')
+              {
+                strcat(orderColumns, ", ");
+              }
+              strcat(orderColumns, buffer->tokens[current].value);
+              if (direction)
+              {
+                strcat(orderColumns, " ");
+                strcat(orderColumns, direction);
+              }
+            }
+
+            if (direction)
+            {
+              current++;
+            }
+
+            if (current + 2 < buffer->count &&
+                strcmp(buffer->tokens[current + 1].value, ",") == 0 &&
+                buffer->tokens[current + 2].type == TOKEN_IDENTIFIER)
+            {
+              current += 2;
+            }
+            else
+            {
+              break;
+            }
+          }
+
+          char result[MAX_OPERAND_LENGTH] = "";
+          if (currentResult)
+          {
+            strcpy(result, currentResult);
+          }
+
+          // ORDER BY followed by LIMIT only needs the first rows
+          char limit[MAX_OPERATOR_LENGTH] = "";
+          char offset[MAX_OPERATOR_LENGTH] = "";
+          int limitStart = current + 1;
+          if (limitStart < buffer->count &&
+              strcmp(buffer->tokens[limitStart].value, "LIMIT") == 0 &&
+              readLimitClause(buffer, &limitStart, limit, offset))
+          {
+            current = limitStart;
+
+            char topCount[MAX_OPERATOR_LENGTH];
+            snprintf(topCount, sizeof(topCount), "%llu",
+                     strtoull(limit, NULL, 10) + strtoull(offset, NULL, 10));
+
+            char *topResult = generateTempVar();
+            addIntermediateCodeInstruction(
+                IR_TOP_N,
+                topResult,
+                result,
+                orderColumns,
+                topCount);
+            currentResult = topResult;
+
+            if (offset[0] != '\0')
+            {
+              strcpy(result, currentResult);
+              currentResult = generateTempVar();
+              addIntermediateCodeInstruction(
+                  IR_LIMIT,
+                  currentResult,
+                  result,
+                  limit,
+                  offset);
+            }
+          }
+          else
+          {
+            char *orderResult = generateTempVar();
+
+            addIntermediateCodeInstruction(
+                IR_ORDER_BY,
+                orderResult,
+                result,
+                orderColumns,
+                NULL);
+            currentResult = orderResult;
+          }
+        }
+      }
+      else if (strcmp(token.value, "ANALYZE") == 0)
+      {
+        if (current + 1 < buffer->count &&
+            buffer->tokens[current + 1].type == TOKEN_IDENTIFIER)
+        {
+          current++;
+          const char *tableName = buffer->tokens[current].value;
+          char analyzeColumns[MAX_OPERAND_LENGTH] = "";
+
+          // Optional column list; without one every column is analyzed
+          if (current + 1 < buffer->count &&
+              strcmp(buffer->tokens[current + 1].value, "(") == 0)
+          {
+            current += 2;
+            while (current < buffer->count &&
+                   buffer->tokens[current].type == TOKEN_IDENTIFIER)
+            {
+              if (strlen(analyzeColumns) + strlen(buffer->tokens[current].value) + 2 < MAX_OPERAND_LENGTH)
+              {
+                if (analyzeColumns[0] != '\0')
+                {
+                  strcat(analyzeColumns, ", ");
+                }
+                strcat(analyzeColumns, buffer->tokens[current].value);
+              }
+              current++;
+              if (current < buffer->count &&
+                  strcmp(buffer->tokens[current].value, ",") == 0)
+              {
+                current++;
+              }
+            }
+          }
+
+          currentResult = generateTempVar();
+          addIntermediateCodeInstruction(
+              IR_ANALYZE,
+              currentResult,
+              tableName,
+              analyzeColumns,
+              NULL);
+        }
+      }
+      else if (strcmp(token.value, "LIMIT") == 0)
+      {
+        char limit[MAX_OPERATOR_LENGTH] = "";
+        char offset[MAX_OPERATOR_LENGTH] = "";
+
+        if (readLimitClause(buffer, &current, limit, offset))
+        {
+          char result[MAX_OPERAND_LENGTH] = "";
+          if (currentResult)
+          {
+            strcpy(result, currentResult);
+          }
+
+          currentResult = generateTempVar();
+          addIntermediateCodeInstruction(
+              IR_LIMIT,
+              currentResult,
+              result,
+              limit,
+              offset);
+        }
       }
     }
 
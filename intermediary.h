@@ -7,6 +7,7 @@
 #include <stdbool.h>
 
 #include "types.h"
+#include "lexico.h"
 
 #define MAX_INTERMEDIATE_CODE 1000
 #define MAX_OPERAND_LENGTH 100
@@ -32,6 +33,9 @@ typedef enum
     IR_CONCAT,     // Concatenation
     IR_BETWEEN,    // Between operation
     IR_HAVING,     // Having clause
+    IR_LIMIT,      // Limit/offset of the result
+    IR_TOP_N,      // Ordering limited to the first N rows
+    IR_ANALYZE,    // Collect table statistics
 } IntermediateCodeType;
 
 // Struct to represent an intermediate code instruction
@@ -44,6 +48,17 @@ typedef struct
     char operation[MAX_OPERATOR_LENGTH];
 } IntermediateCodeInstruction;
 
+// A single WHERE predicate: column <op> value or column BETWEEN value AND upperValue
+typedef struct
+{
+  char column[MAX_TOKEN_LENGTH];
+  char operation[MAX_OPERATOR_LENGTH];
+  char value[MAX_TOKEN_LENGTH];
+  char upperValue[MAX_TOKEN_LENGTH];
+  TokenType valueType;
+  bool startsGroup; // First predicate, or preceded by OR
+} FilterPredicate;
+
 // Intermediate code generator context
 typedef struct
 {
@@ -52,10 +67,14 @@ typedef struct
     int tempVarCounter;
 } IntermediateCodeContext;
 
+extern IntermediateCodeContext intermediateCodeContext;
+extern const char *IntermediateCodeTypeNames[];
+
 // Function prototypes
 void initIntermediateCodeContext();
 char *generateTempVar();
 void generateIntermediateCode(TokenBuffer *buffer);
+double estimateOperatorSelectivity(const char *operation);
 void addIntermediateCodeInstruction(
     IntermediateCodeType type,
     const char *result,
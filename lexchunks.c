@@ -0,0 +1,258 @@
+#define _GNU_SOURCE
+#include "lexchunks.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lexico.h"
+#include "parser.h"
+#include "allocator.h"
+
+static int lexThreads = 1;
+static bool limitToCpus = true;
+
+// The allocators keep unsynchronized statistics, so chunk buffers are grown
+// one thread at a time. chunkBytes is what all chunks hold together,
+// charged against the same memory budget as the token buffer.
+static pthread_mutex_t chunkAllocationLock = PTHREAD_MUTEX_INITIALIZER;
+static size_t chunkBytes = 0;
+
+void setLexThreads(int threads) {
+    if (threads < 1) {
+        threads = 1;
+    } else if (threads > LEX_MAX_THREADS) {
+        threads = LEX_MAX_THREADS;
+    }
+    lexThreads = threads;
+}
+
+int getLexThreads(void) {
+    return lexThreads;
+}
+
+// Tests turn the limit off to run the chunked path on a single CPU
+void limitLexThreadsToCpus(bool limit) {
+    limitToCpus = limit;
+}
+
+// Fails when the chunks together would pass the memory budget; the input
+// is then lexed serially, where the token buffer reports the overrun
+static bool appendChunkToken(LexChunk* chunk, Token token) {
+    if (chunk->count == chunk->capacity) {
+        size_t capacity = chunk->capacity ? chunk->capacity * 2 : INITIAL_TOKEN_BUFFER_SIZE;
+        size_t growth = sizeof(Token) * (capacity - chunk->capacity);
+
+        pthread_mutex_lock(&chunkAllocationLock);
+        Token* tokens = NULL;
+        if (chunkBytes + growth <= getMemoryBudget()) {
+            tokens = compilerRealloc(chunk->tokens, sizeof(Token) * chunk->capacity,
+                                     sizeof(Token) * capacity);
+        }
+        if (tokens) {
+            chunkBytes += growth;
+        }
+        pthread_mutex_unlock(&chunkAllocationLock);
+
+        if (!tokens) {
+            return false;
+        }
+        chunk->tokens = tokens;
+        chunk->capacity = capacity;
+    }
+    chunk->tokens[chunk->count++] = token;
+    return true;
+}
+
+// Only called once the worker threads have been joined
+static void releaseChunkTokens(LexChunk* chunk) {
+    compilerFree(chunk->tokens, sizeof(Token) * chunk->capacity);
+    chunkBytes -= sizeof(Token) * chunk->capacity;
+    chunk->tokens = NULL;
+    chunk->count = 0;
+    chunk->capacity = 0;
+}
+
+// The lexer resumes inside a string it had to truncate, which no chunk
+// boundary can reproduce
+static bool isTruncatedString(const Token* token) {
+    return token->type == TOKEN_STRING && strlen(token->value) > MAX_STRING_CONTENT;
+}
+
+static bool isUnterminatedString(const Token* token) {
+    size_t length = strlen(token->value);
+    return token->type == TOKEN_STRING &&
+           (length < 2 || token->value[length - 1] != token->value[0]);
+}
+
+static void lexChunk(LexChunk* chunk) {
+    chunk->count = 0;
+    chunk->failed = false;
+    FILE* input = fmemopen((void*)chunk->text, chunk->length, "r");
+    if (!input) {
+        chunk->failed = true;
+        return;
+    }
+
+    int line = 1, column = 1;
+    Token token;
+    do {
+        token = scanToken(input, &line, &column);
+        if (token.type == TOKEN_ERROR || isTruncatedString(&token) ||
+            !appendChunkToken(chunk, token)) {
+            chunk->failed = true;
+            break;
+        }
+    } while (token.type != TOKEN_EOF);
+    chunk->endLine = line;
+    fclose(input);
+}
+
+static void* lexChunkThread(void* argument) {
+    lexChunk(argument);
+    return NULL;
+}
+
+// Speculative split: each chunk ends at the first newline after an even
+// share of the input. A newline is a token boundary unless it sits inside
+// a string, which the lexer itself reveals afterwards.
+static int splitChunks(const char* text, size_t length, int threads, LexChunk* chunks) {
+    int count = 0;
+    size_t start = 0;
+    for (int i = 1; i <= threads && start < length; i++) {
+        size_t end = i == threads ? length : length / threads * i;
+        if (end < start) {
+            end = start;
+        }
+        const char* newline = end < length ? memchr(text + end, '\n', length - end) : NULL;
+        end = newline ? (size_t)(newline - text) + 1 : length;
+
+        memset(&chunks[count], 0, sizeof(LexChunk));
+        chunks[count].text = text + start;
+        chunks[count].length = end - start;
+        count++;
+        start = end;
+    }
+    return count;
+}
+
+// Lexes a regular file of at least LEX_PARALLEL_MIN_BYTES on up to
+// getLexThreads() threads, normally no more than there are CPUs online,
+// within the memory budget. Returns
+// false, with the stream untouched, when the input must be lexed serially
+// instead; errors always go that way so they are reported exactly as
+// getNextToken reports them.
+bool lexInParallel(FILE* input, LexedTokens* lexed) {
+    memset(lexed, 0, sizeof(*lexed));
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    int threadCount = limitToCpus && processors > 0 && processors < lexThreads ?
+                      (int)processors : lexThreads;
+    int fd = fileno(input);
+    struct stat info;
+    if (threadCount < 2 || fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+        info.st_size < LEX_PARALLEL_MIN_BYTES || ftell(input) != 0) {
+        return false;
+    }
+
+    size_t length = (size_t)info.st_size;
+    const char* text = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (text == MAP_FAILED) {
+        return false;
+    }
+    LexChunk* chunks = compilerAlloc(sizeof(LexChunk) * threadCount);
+    if (!chunks) {
+        munmap((void*)text, length);
+        return false;
+    }
+    chunkBytes = 0;
+
+    int count = splitChunks(text, length, threadCount, chunks);
+    pthread_t threads[LEX_MAX_THREADS];
+    bool started[LEX_MAX_THREADS] = {false};
+    for (int i = 1; i < count; i++) {
+        started[i] = pthread_create(&threads[i], NULL, lexChunkThread, &chunks[i]) == 0;
+    }
+    lexChunk(&chunks[0]);
+    for (int i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            lexChunk(&chunks[i]);
+        }
+    }
+
+    // Check the boundaries in order. A chunk ending in an open string was
+    // split inside it, so it absorbs the next chunk and is lexed again.
+    bool ok = true;
+    for (int i = 0; i < count && ok; ) {
+        LexChunk* chunk = &chunks[i];
+        if (chunk->failed) {
+            ok = false;
+        } else if (i + 1 < count && chunk->count >= 2 &&
+                   isUnterminatedString(&chunk->tokens[chunk->count - 2])) {
+            chunk->length += chunks[i + 1].length;
+            releaseChunkTokens(&chunks[i + 1]);
+            memmove(&chunks[i + 1], &chunks[i + 2], sizeof(LexChunk) * (count - i - 2));
+            count--;
+            lexChunk(chunk);
+        } else {
+            chunk->lineOffset = i == 0 ? 0 : chunks[i - 1].lineOffset + chunks[i - 1].endLine - 1;
+            i++;
+        }
+    }
+    munmap((void*)text, length);
+
+    lexed->chunks = chunks;
+    lexed->count = count;
+    lexed->allocated = threadCount;
+    if (!ok) {
+        freeLexedTokens(lexed);
+        return false;
+    }
+    return true;
+}
+
+// Returns the tokens in the order getNextToken would, recording symbols
+// as it goes. A chunk is released once consumed, so its tokens and the
+// token buffer they are copied into do not both stay resident. Must not be
+// called past the final EOF.
+Token nextLexedToken(LexedTokens* lexed) {
+    for (;;) {
+        LexChunk* chunk = &lexed->chunks[lexed->current];
+        Token token = chunk->tokens[lexed->next++];
+        token.line += chunk->lineOffset;
+
+        if (token.type == TOKEN_EOF && lexed->current < lexed->count - 1) {
+            // Serially, this call would have skipped whitespace on into the
+            // next chunk and its token would carry this start position
+            if (!lexed->carryPosition) {
+                lexed->carryPosition = true;
+                lexed->carryLine = token.line;
+                lexed->carryColumn = token.column;
+            }
+            releaseChunkTokens(chunk);
+            lexed->current++;
+            lexed->next = 0;
+            continue;
+        }
+
+        if (lexed->carryPosition) {
+            token.line = lexed->carryLine;
+            token.column = lexed->carryColumn;
+            lexed->carryPosition = false;
+        }
+        if (token.type == TOKEN_IDENTIFIER) {
+            addSymbol(token.value, "IDENTIFIER", 0);
+        }
+        return token;
+    }
+}
+
+void freeLexedTokens(LexedTokens* lexed) {
+    for (int i = 0; i < lexed->count; i++) {
+        releaseChunkTokens(&lexed->chunks[i]);
+    }
+    compilerFree(lexed->chunks, sizeof(LexChunk) * lexed->allocated);
+    memset(lexed, 0, sizeof(*lexed));
+}
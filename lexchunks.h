@@ -0,0 +1,44 @@
+#ifndef LEXCHUNKS_H
+#define LEXCHUNKS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+
+#define LEX_PARALLEL_MIN_BYTES (1 << 20)    // Smaller inputs are lexed serially
+#define LEX_MAX_THREADS 64
+
+// Part of the input ending just after a newline, lexed on its own with
+// lines counted from 1
+typedef struct {
+    const char* text;
+    size_t length;
+    Token* tokens;
+    size_t count;
+    size_t capacity;
+    int endLine;        // Lexer line when the chunk ran out
+    int lineOffset;     // Lines before the chunk, added when stitching
+    bool failed;        // Error token, truncated string, or memory budget or heap exhausted
+} LexChunk;
+
+// Token stream stitched from the chunks, in input order
+typedef struct {
+    LexChunk* chunks;
+    int count;
+    int allocated;       // Chunks allocated, before any were merged
+    int current;
+    size_t next;
+    bool carryPosition;  // Next token starts where the last chunk's EOF did
+    int carryLine;
+    int carryColumn;
+} LexedTokens;
+
+void setLexThreads(int threads);
+int getLexThreads(void);
+void limitLexThreadsToCpus(bool limit);
+bool lexInParallel(FILE* input, LexedTokens* lexed);
+Token nextLexedToken(LexedTokens* lexed);
+void freeLexedTokens(LexedTokens* lexed);
+
+#endif
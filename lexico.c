@@ -11,6 +11,7 @@ const char *TokenTypeNames[] = {
     "KEYWORD",
     "STRING",
     "CHAR",
+    "PARAMETER",
     "COMMENT",
     "SEMICOLON",
     "EOF",
@@ -23,12 +24,18 @@ const char* SQL_KEYWORDS[] = {
     "AND", "OR", "NOT", "IN", "BETWEEN", "LIKE", "IS", "NULL",
     "ORDER", "BY", "GROUP", "HAVING", "JOIN", "LEFT", "RIGHT",
     "INNER", "OUTER", "ON", "AS", "DISTINCT", "COUNT", "SUM",
-    "AVG", "MAX", "MIN", "INTO", "VALUES", "SET", "BETWEEN", "DESC", NULL
+    "AVG", "MAX", "MIN", "INTO", "VALUES", "SET", "BETWEEN", "ASC", "DESC",
+    "LIMIT", "OFFSET", "ANALYZE", "EXPLAIN", NULL
+};
+
+const char* AggregateFunctionNames[] = {
+    "COUNT", "SUM", "AVG", "MAX", "MIN"
 };
 
 Symbol symbolTable[MAX_SYMBOLS];
 int symbolCount = 0;
 CompilerError currentError = {NULL, 0, 0, ""};
+FILE *compilerOutput = NULL;
 
 bool isKeyword(const char* str) {
     char upperStr[MAX_TOKEN_LENGTH];
@@ -47,6 +54,15 @@ bool isKeyword(const char* str) {
     return false;
 }
 
+AggregateFunction getAggregateFunction(const char* str) {
+    for(int i = 0; i < AGG_NONE; i++) {
+        if(strcasecmp(str, AggregateFunctionNames[i]) == 0) {
+            return (AggregateFunction)i;
+        }
+    }
+    return AGG_NONE;
+}
+
 int findSymbol(const char *name) {
     for(int i = 0; i < symbolCount; i++) {
         if(strcmp(symbolTable[i].name, name) == 0) {
@@ -71,21 +87,31 @@ int addSymbol(const char *name, const char *type, int scope) {
     return symbolCount++;
 }
 
+void resetSymbolTable() {
+    symbolCount = 0;
+}
+
+int getSymbolCount() {
+    return symbolCount;
+}
+
 void printSymbolTable() {
-    printf("\nSymbol Table:\n");
-    printf("ID | Name                | Type      | Scope\n");
-    printf("---|---------------------|-----------|-------\n");
+    fprintf(compilerOutput, "\nSymbol Table:\n");
+    fprintf(compilerOutput, "ID | Name                | Type      | Scope\n");
+    fprintf(compilerOutput, "---|---------------------|-----------|-------\n");
     for(int i = 0; i < symbolCount; i++) {
-        printf("%-3d| %-19s | %-9s | %d\n",
+        fprintf(compilerOutput, "%-3d| %-19s | %-9s | %d\n",
             symbolTable[i].id,
             symbolTable[i].name,
             symbolTable[i].type,
             symbolTable[i].scope);
     }
-    printf("\n");
+    fprintf(compilerOutput, "\n");
 }
 
-Token getNextToken(FILE *input, int *line, int *column) {
+// Symbols are recorded only when lexing serially; chunk lexers leave the
+// shared table alone and the stitcher records them in token order
+static Token readToken(FILE *input, int *line, int *column, bool recordSymbols) {
     Token token;
     token.line = *line;
     token.column = *column;
@@ -133,7 +159,7 @@ Token getNextToken(FILE *input, int *line, int *column) {
         token.type = TOKEN_STRING;
         token.value[pos++] = c;
         while((c = fgetc(input)) != EOF && c != delimiter) {
-            if(pos >= MAX_TOKEN_LENGTH - 1) break;
+            if(pos > MAX_STRING_CONTENT) break;
             if(c == '\n') {
                 (*line)++;
                 *column = 1;
@@ -205,7 +231,7 @@ Token getNextToken(FILE *input, int *line, int *column) {
         // Check if the token is a keyword AFTER checking identifier format
         if(isKeyword(token.value)) {
             token.type = TOKEN_KEYWORD;
-        } else {
+        } else if(recordSymbols) {
             addSymbol(token.value, "IDENTIFIER", 0);
         }
         return token;
@@ -222,6 +248,9 @@ Token getNextToken(FILE *input, int *line, int *column) {
         case ',': case '(': case ')':
             token.type = TOKEN_DELIMITER;
             break;
+        case '?':
+            token.type = TOKEN_PARAMETER;
+            break;
         case '+': case '-': case '*': case '/':
         case '=': case '<': case '>': case '!':
             token.type = TOKEN_OPERATOR;
@@ -242,4 +271,14 @@ Token getNextToken(FILE *input, int *line, int *column) {
     }
     
     return token;
-}
\ No newline at end of file
+}
+
+Token getNextToken(FILE *input, int *line, int *column) {
+    return readToken(input, line, column, true);
+}
+
+// Same as getNextToken without touching the symbol table, so it can run
+// on several streams at once
+Token scanToken(FILE *input, int *line, int *column) {
+    return readToken(input, line, column, false);
+}
@@ -5,12 +5,24 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
+#include <strings.h>
 #include "types.h"
 
+// Bytes a string literal keeps after its opening quote, leaving room for
+// the closing one. The lexer drops the byte it stops on and resumes there.
+#define MAX_STRING_CONTENT (MAX_TOKEN_LENGTH - 3)
+
+// Destination of everything a compilation prints (stdout by default)
+extern FILE *compilerOutput;
+
 bool isKeyword(const char* str);
+AggregateFunction getAggregateFunction(const char* str);
 int findSymbol(const char *name);
 int addSymbol(const char *name, const char *type, int scope);
+void resetSymbolTable(void);
+int getSymbolCount(void);
 void printSymbolTable(void);
 Token getNextToken(FILE *input, int *line, int *column);
+Token scanToken(FILE *input, int *line, int *column);
 
 #endif
\ No newline at end of file
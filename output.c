@@ -0,0 +1,131 @@
+#include "output.h"
+#include <stdio.h>
+#include <string.h>
+#include "lexico.h"
+#include "intermediary.h"
+
+static Verbosity outputVerbosity = VERBOSITY_DEBUG;
+static OutputFormat outputFormat = OUTPUT_TEXT;
+static int diagnosticCount = 0;
+
+static const char* VerbosityNames[] = {
+    "silent",
+    "normal",
+    "ir",
+    "debug"
+};
+
+void setVerbosity(Verbosity verbosity) {
+    outputVerbosity = verbosity;
+}
+
+bool parseVerbosity(const char* name, Verbosity* verbosity) {
+    for (int i = 0; i <= VERBOSITY_DEBUG; i++) {
+        if (strcmp(name, VerbosityNames[i]) == 0) {
+            *verbosity = (Verbosity)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void setOutputFormat(OutputFormat format) {
+    outputFormat = format;
+}
+
+bool isTextOutput(void) {
+    return outputFormat == OUTPUT_TEXT;
+}
+
+// True when human-readable output at this level should be printed
+bool shouldPrint(Verbosity level) {
+    return outputFormat == OUTPUT_TEXT && outputVerbosity >= level;
+}
+
+static void writeJsonString(const char* value) {
+    fputc('"', compilerOutput);
+    for (const unsigned char* c = (const unsigned char*)value; *c; c++) {
+        switch (*c) {
+            case '"':  fputs("\\\"", compilerOutput); break;
+            case '\\': fputs("\\\\", compilerOutput); break;
+            case '\n': fputs("\\n", compilerOutput); break;
+            case '\t': fputs("\\t", compilerOutput); break;
+            case '\r': fputs("\\r", compilerOutput); break;
+            default:
+                if (*c < 0x20) {
+                    fprintf(compilerOutput, "\\u%04x", *c);
+                } else {
+                    fputc(*c, compilerOutput);
+                }
+        }
+    }
+    fputc('"', compilerOutput);
+}
+
+// Counts an error; in JSON mode it is also emitted. Text callers print
+// their own message so the existing wording is kept.
+void reportDiagnostic(const char* phase, int line, int column, const char* message) {
+    diagnosticCount++;
+    if (outputFormat != OUTPUT_JSON) {
+        return;
+    }
+    fprintf(compilerOutput, "{\"type\":\"diagnostic\",\"phase\":");
+    writeJsonString(phase);
+    fprintf(compilerOutput, ",\"line\":%d,\"column\":%d,\"message\":", line, column);
+    writeJsonString(message);
+    fprintf(compilerOutput, "}\n");
+}
+
+int getDiagnosticCount(void) {
+    return diagnosticCount;
+}
+
+void emitIntermediateCodeJson(const char* filename, bool cached, const ParameterList* parameters) {
+    if (outputFormat != OUTPUT_JSON || outputVerbosity < VERBOSITY_IR) {
+        return;
+    }
+
+    fprintf(compilerOutput, "{\"type\":\"ir\",\"file\":");
+    writeJsonString(filename);
+    fprintf(compilerOutput, ",\"cached\":%s,\"instructions\":[", cached ? "true" : "false");
+    for (int i = 0; i < intermediateCodeContext.instructionCount; i++) {
+        const IntermediateCodeInstruction* instr = &intermediateCodeContext.instructions[i];
+        fprintf(compilerOutput, "%s{\"op\":", i > 0 ? "," : "");
+        writeJsonString(IntermediateCodeTypeNames[instr->type]);
+        fprintf(compilerOutput, ",\"result\":");
+        writeJsonString(instr->result);
+        fprintf(compilerOutput, ",\"op1\":");
+        writeJsonString(instr->op1);
+        fprintf(compilerOutput, ",\"op2\":");
+        writeJsonString(instr->op2);
+        fprintf(compilerOutput, ",\"operation\":");
+        writeJsonString(instr->operation);
+        fputc('}', compilerOutput);
+    }
+
+    fprintf(compilerOutput, "],\"parameters\":[");
+    for (int i = 0; i < parameters->count; i++) {
+        const QueryParameter* parameter = &parameters->parameters[i];
+        fprintf(compilerOutput, "%s{\"slot\":%d,\"type\":\"%s\",\"value\":", i > 0 ? "," : "",
+                i + 1, DataTypeNames[parameter->dataType]);
+        if (parameter->list) {
+            fprintf(compilerOutput, "null,\"count\":%d,\"probe\":", parameter->list->count);
+            writeJsonString(ProbeStrategyNames[parameter->list->probe]);
+        } else if (parameter->isBound) {
+            writeJsonString(parameter->value);
+        } else {
+            fputs("null", compilerOutput);
+        }
+        fputc('}', compilerOutput);
+    }
+    fprintf(compilerOutput, "]}\n");
+}
+
+void emitCompilationResult(const char* filename, bool ok) {
+    if (outputFormat != OUTPUT_JSON || outputVerbosity < VERBOSITY_NORMAL) {
+        return;
+    }
+    fprintf(compilerOutput, "{\"type\":\"result\",\"file\":");
+    writeJsonString(filename);
+    fprintf(compilerOutput, ",\"ok\":%s}\n", ok ? "true" : "false");
+}
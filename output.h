@@ -0,0 +1,31 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdbool.h>
+#include "plancache.h"
+
+// How much a compilation prints; errors are always reported
+typedef enum {
+    VERBOSITY_SILENT,   // Errors only
+    VERBOSITY_NORMAL,   // Phase banners and results
+    VERBOSITY_IR,       // Plus intermediate code and parameters
+    VERBOSITY_DEBUG     // Plus every token and the symbol table
+} Verbosity;
+
+typedef enum {
+    OUTPUT_TEXT,
+    OUTPUT_JSON         // One JSON object per line for diagnostics, IR and results
+} OutputFormat;
+
+void setVerbosity(Verbosity verbosity);
+bool parseVerbosity(const char* name, Verbosity* verbosity);
+void setOutputFormat(OutputFormat format);
+bool isTextOutput(void);
+bool shouldPrint(Verbosity level);
+
+void reportDiagnostic(const char* phase, int line, int column, const char* message);
+int getDiagnosticCount(void);
+void emitIntermediateCodeJson(const char* filename, bool cached, const ParameterList* parameters);
+void emitCompilationResult(const char* filename, bool ok);
+
+#endif
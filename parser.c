@@ -1,6 +1,9 @@
 #include "parser.h"
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include "allocator.h"
+#include "output.h"
 
 void setError(const char *message, int line, int column, const char *context)
 {
@@ -23,29 +26,78 @@ void clearError()
     currentError.context[0] = '\0';
 }
 
+// First error of the last semantic analysis, kept after its context is freed
+static char firstSemanticError[MAX_ERROR_LENGTH];
+
+const char *getFirstSemanticError()
+{
+    return firstSemanticError[0] != '\0' ? firstSemanticError : NULL;
+}
+
+// Limite de memória para o buffer de tokens (configurável via --memory-budget)
+static size_t tokenMemoryBudget = DEFAULT_MEMORY_BUDGET;
+
+void setMemoryBudget(size_t bytes)
+{
+    tokenMemoryBudget = bytes;
+}
+
+size_t getMemoryBudget()
+{
+    return tokenMemoryBudget;
+}
+
 TokenBuffer *createTokenBuffer()
 {
-    TokenBuffer *buffer = malloc(sizeof(TokenBuffer));
+    TokenBuffer *buffer = compilerAlloc(sizeof(TokenBuffer));
+    if (buffer == NULL)
+    {
+        return NULL;
+    }
     buffer->capacity = INITIAL_TOKEN_BUFFER_SIZE;
-    buffer->tokens = malloc(sizeof(Token) * buffer->capacity);
+    buffer->tokens = compilerAlloc(sizeof(Token) * buffer->capacity);
+    if (buffer->tokens == NULL)
+    {
+        compilerFree(buffer, sizeof(TokenBuffer));
+        return NULL;
+    }
     buffer->count = 0;
     return buffer;
 }
 
-void addTokenToBuffer(TokenBuffer *buffer, Token token)
+bool addTokenToBuffer(TokenBuffer *buffer, Token token)
 {
     if (buffer->count >= buffer->capacity)
     {
-        buffer->capacity *= 2;
-        buffer->tokens = realloc(buffer->tokens, sizeof(Token) * buffer->capacity);
+        // Grow geometrically, but never past the memory budget
+        size_t maxCapacity = tokenMemoryBudget / sizeof(Token);
+        size_t newCapacity = (size_t)buffer->capacity * 2;
+        if (newCapacity > maxCapacity)
+        {
+            newCapacity = maxCapacity;
+        }
+        if (newCapacity <= (size_t)buffer->count || newCapacity > INT_MAX)
+        {
+            return false;
+        }
+
+        Token *tokens = compilerRealloc(buffer->tokens, sizeof(Token) * buffer->capacity,
+                                        sizeof(Token) * newCapacity);
+        if (tokens == NULL)
+        {
+            return false;
+        }
+        buffer->tokens = tokens;
+        buffer->capacity = (int)newCapacity;
     }
     buffer->tokens[buffer->count++] = token;
+    return true;
 }
 
 void freeTokenBuffer(TokenBuffer *buffer)
 {
-    free(buffer->tokens);
-    free(buffer);
+    compilerFree(buffer->tokens, sizeof(Token) * buffer->capacity);
+    compilerFree(buffer, sizeof(TokenBuffer));
 }
 
 bool parseColumnList(TokenBuffer *buffer, int *current)
@@ -107,18 +159,8 @@ bool parseProjectionItem(TokenBuffer *buffer, int *current)
     // Aggregate functions
     if (buffer->tokens[*current].type == TOKEN_KEYWORD)
     {
-        const char *aggregateFunctions[] = {
-            "COUNT", "SUM", "AVG", "MAX", "MIN"};
-        bool isAggregateFunction = false;
-
-        for (size_t i = 0; i < sizeof(aggregateFunctions) / sizeof(aggregateFunctions[0]); i++)
-        {
-            if (strcmp(buffer->tokens[*current].value, aggregateFunctions[i]) == 0)
-            {
-                isAggregateFunction = true;
-                break;
-            }
-        }
+        bool isAggregateFunction =
+            getAggregateFunction(buffer->tokens[*current].value) != AGG_NONE;
 
         if (isAggregateFunction)
         {
@@ -218,6 +260,19 @@ bool parseProjectionItem(TokenBuffer *buffer, int *current)
     return true;
 }
 
+// LIMIT and OFFSET counts travel as IR operands and their sum becomes the
+// TOP_N count, so each count and the sum must stay within LLONG_MAX, which
+// also keeps them inside an operator string
+static bool readRowCount(const Token *token, unsigned long long *count)
+{
+    if (strlen(token->value) >= MAX_OPERATOR_LENGTH)
+    {
+        return false;
+    }
+    *count = strtoull(token->value, NULL, 10);
+    return *count <= LLONG_MAX;
+}
+
 bool parseSelectStatement(TokenBuffer *buffer, int *current)
 {
     // Verify SELECT keyword
@@ -351,7 +406,9 @@ bool parseSelectStatement(TokenBuffer *buffer, int *current)
                  (strcmp(buffer->tokens[*current].value, "JOIN") == 0 ||
                   strcmp(buffer->tokens[*current].value, "WHERE") == 0 ||
                   strcmp(buffer->tokens[*current].value, "GROUP") == 0 ||
-                  strcmp(buffer->tokens[*current].value, "ORDER") == 0)))
+                  strcmp(buffer->tokens[*current].value, "ORDER") == 0 ||
+                  strcmp(buffer->tokens[*current].value, "LIMIT") == 0)) ||
+                buffer->tokens[*current].type == TOKEN_SEMICOLON)
             {
                 break;
             }
@@ -422,7 +479,8 @@ bool parseSelectStatement(TokenBuffer *buffer, int *current)
             if (*current < buffer->count &&
                 buffer->tokens[*current].type == TOKEN_KEYWORD &&
                 (strcmp(buffer->tokens[*current].value, "HAVING") == 0 ||
-                 strcmp(buffer->tokens[*current].value, "ORDER") == 0))
+                 strcmp(buffer->tokens[*current].value, "ORDER") == 0 ||
+                 strcmp(buffer->tokens[*current].value, "LIMIT") == 0))
             {
                 break;
             }
@@ -440,8 +498,10 @@ bool parseSelectStatement(TokenBuffer *buffer, int *current)
         while (*current < buffer->count)
         {
             // Break when next major clause is encountered
-            if (buffer->tokens[*current].type == TOKEN_KEYWORD &&
-                (strcmp(buffer->tokens[*current].value, "ORDER") == 0))
+            if ((buffer->tokens[*current].type == TOKEN_KEYWORD &&
+                 (strcmp(buffer->tokens[*current].value, "ORDER") == 0 ||
+                  strcmp(buffer->tokens[*current].value, "LIMIT") == 0)) ||
+                buffer->tokens[*current].type == TOKEN_SEMICOLON)
             {
                 break;
             }
@@ -499,8 +559,8 @@ bool parseSelectStatement(TokenBuffer *buffer, int *current)
             // Optional sort direction
             if (*current < buffer->count &&
                 buffer->tokens[*current].type == TOKEN_KEYWORD &&
-                (strcmp(buffer->tokens[*current].value, "ASC") == 0 ||
-                 strcmp(buffer->tokens[*current].value, "DESC") == 0))
+                (strcasecmp(buffer->tokens[*current].value, "ASC") == 0 ||
+                 strcasecmp(buffer->tokens[*current].value, "DESC") == 0))
             {
                 (*current)++;
             }
@@ -514,6 +574,64 @@ bool parseSelectStatement(TokenBuffer *buffer, int *current)
         }
     }
 
+    // Optional LIMIT clause
+    if (*current < buffer->count &&
+        buffer->tokens[*current].type == TOKEN_KEYWORD &&
+        strcmp(buffer->tokens[*current].value, "LIMIT") == 0)
+    {
+        (*current)++;
+
+        // Row count
+        if (*current >= buffer->count ||
+            buffer->tokens[*current].type != TOKEN_INTEGER)
+        {
+            setError("Expected row count after LIMIT",
+                     buffer->tokens[*current - 1].line,
+                     buffer->tokens[*current - 1].column,
+                     buffer->tokens[*current - 1].value);
+            return false;
+        }
+        unsigned long long limit;
+        if (!readRowCount(&buffer->tokens[*current], &limit))
+        {
+            setError("Row count after LIMIT is too large",
+                     buffer->tokens[*current].line,
+                     buffer->tokens[*current].column,
+                     buffer->tokens[*current].value);
+            return false;
+        }
+        (*current)++;
+
+        // Optional OFFSET
+        if (*current < buffer->count &&
+            buffer->tokens[*current].type == TOKEN_KEYWORD &&
+            strcmp(buffer->tokens[*current].value, "OFFSET") == 0)
+        {
+            (*current)++;
+
+            if (*current >= buffer->count ||
+                buffer->tokens[*current].type != TOKEN_INTEGER)
+            {
+                setError("Expected row count after OFFSET",
+                         buffer->tokens[*current - 1].line,
+                         buffer->tokens[*current - 1].column,
+                         buffer->tokens[*current - 1].value);
+                return false;
+            }
+            unsigned long long offset;
+            if (!readRowCount(&buffer->tokens[*current], &offset) ||
+                offset > LLONG_MAX - limit)
+            {
+                setError("Row count after OFFSET is too large",
+                         buffer->tokens[*current].line,
+                         buffer->tokens[*current].column,
+                         buffer->tokens[*current].value);
+                return false;
+            }
+            (*current)++;
+        }
+    }
+
     if (*current >= buffer->count || buffer->tokens[*current].type != TOKEN_SEMICOLON)
     {
         setError("Expected semicolon (;) at the end of the statement",
@@ -533,6 +651,142 @@ bool parseSelectStatement(TokenBuffer *buffer, int *current)
     return true;
 }
 
+// EXPLAIN [ANALYZE] SELECT ...
+bool parseExplainStatement(TokenBuffer *buffer, int *current)
+{
+    // Skip EXPLAIN keyword
+    (*current)++;
+
+    if (*current + 1 < buffer->count &&
+        strcmp(buffer->tokens[*current].value, "ANALYZE") == 0 &&
+        strcmp(buffer->tokens[*current + 1].value, "SELECT") == 0)
+    {
+        (*current)++;
+    }
+
+    if (*current >= buffer->count ||
+        buffer->tokens[*current].type != TOKEN_KEYWORD ||
+        strcmp(buffer->tokens[*current].value, "SELECT") != 0)
+    {
+        setError("Expected SELECT after EXPLAIN",
+                 buffer->tokens[*current - 1].line,
+                 buffer->tokens[*current - 1].column,
+                 buffer->tokens[*current - 1].value);
+        return false;
+    }
+    return parseSelectStatement(buffer, current);
+}
+
+bool parseAnalyzeStatement(TokenBuffer *buffer, int *current)
+{
+    // Skip ANALYZE keyword
+    (*current)++;
+
+    // Table name
+    if (*current >= buffer->count ||
+        buffer->tokens[*current].type != TOKEN_IDENTIFIER)
+    {
+        setError("Expected table name after ANALYZE",
+                 buffer->tokens[*current - 1].line,
+                 buffer->tokens[*current - 1].column,
+                 buffer->tokens[*current - 1].value);
+        return false;
+    }
+    (*current)++;
+
+    // Optional column list
+    if (*current < buffer->count &&
+        buffer->tokens[*current].type == TOKEN_DELIMITER &&
+        strcmp(buffer->tokens[*current].value, "(") == 0)
+    {
+        (*current)++;
+        if (!parseColumnList(buffer, current))
+        {
+            return false;
+        }
+
+        if (buffer->tokens[*current].type != TOKEN_DELIMITER ||
+            strcmp(buffer->tokens[*current].value, ")") != 0)
+        {
+            setError("Expected ')' after column list",
+                     buffer->tokens[*current].line,
+                     buffer->tokens[*current].column,
+                     buffer->tokens[*current].value);
+            return false;
+        }
+        (*current)++;
+    }
+
+    if (*current >= buffer->count || buffer->tokens[*current].type != TOKEN_SEMICOLON)
+    {
+        setError("Expected semicolon (;) at the end of the statement",
+                 buffer->tokens[*current].line,
+                 buffer->tokens[*current].column,
+                 buffer->tokens[*current].value);
+        return false;
+    }
+    (*current)++;
+    return true;
+}
+
+// [NOT] IN ( value, ... ), leaving current after the closing parenthesis.
+// The values must all be strings or all be numbers; placeholders match
+// either.
+static bool parseInList(TokenBuffer *buffer, int *current)
+{
+    if (strcmp(buffer->tokens[*current].value, "NOT") == 0)
+    {
+        (*current)++;
+    }
+    (*current)++;
+
+    if (*current >= buffer->count || strcmp(buffer->tokens[*current].value, "(") != 0)
+    {
+        setError("Expected '(' after IN",
+                 buffer->tokens[*current - 1].line,
+                 buffer->tokens[*current - 1].column,
+                 buffer->tokens[*current - 1].value);
+        return false;
+    }
+    (*current)++;
+
+    // Value types are checked during semantic analysis
+    while (true)
+    {
+        if (*current >= buffer->count ||
+            (buffer->tokens[*current].type != TOKEN_STRING &&
+             buffer->tokens[*current].type != TOKEN_INTEGER &&
+             buffer->tokens[*current].type != TOKEN_FLOAT &&
+             buffer->tokens[*current].type != TOKEN_PARAMETER))
+        {
+            setError("Expected value in IN list",
+                     buffer->tokens[*current].line,
+                     buffer->tokens[*current].column,
+                     buffer->tokens[*current].value);
+            return false;
+        }
+        (*current)++;
+
+        if (*current < buffer->count && strcmp(buffer->tokens[*current].value, ",") == 0)
+        {
+            (*current)++;
+        }
+        else if (*current < buffer->count && strcmp(buffer->tokens[*current].value, ")") == 0)
+        {
+            (*current)++;
+            return true;
+        }
+        else
+        {
+            setError("Expected ',' or ')' in IN list",
+                     buffer->tokens[*current].line,
+                     buffer->tokens[*current].column,
+                     buffer->tokens[*current].value);
+            return false;
+        }
+    }
+}
+
 bool parseWhereClause(TokenBuffer *buffer, int *current)
 {
     // Enhanced WHERE clause parsing
@@ -572,7 +826,8 @@ bool parseWhereClause(TokenBuffer *buffer, int *current)
                 if (*current >= buffer->count ||
                     (buffer->tokens[*current].type != TOKEN_STRING &&
                      buffer->tokens[*current].type != TOKEN_INTEGER &&
-                     buffer->tokens[*current].type != TOKEN_FLOAT))
+                     buffer->tokens[*current].type != TOKEN_FLOAT &&
+                     buffer->tokens[*current].type != TOKEN_PARAMETER))
                 {
                     setError("Expected value after BETWEEN",
                              buffer->tokens[*current].line,
@@ -599,7 +854,8 @@ bool parseWhereClause(TokenBuffer *buffer, int *current)
                 if (*current >= buffer->count ||
                     (buffer->tokens[*current].type != TOKEN_STRING &&
                      buffer->tokens[*current].type != TOKEN_INTEGER &&
-                     buffer->tokens[*current].type != TOKEN_FLOAT))
+                     buffer->tokens[*current].type != TOKEN_FLOAT &&
+                     buffer->tokens[*current].type != TOKEN_PARAMETER))
                 {
                     setError("Expected value after AND in BETWEEN",
                              buffer->tokens[*current].line,
@@ -609,6 +865,16 @@ bool parseWhereClause(TokenBuffer *buffer, int *current)
                 }
                 (*current)++;
             }
+            else if (strcmp(buffer->tokens[*current].value, "IN") == 0 ||
+                     (strcmp(buffer->tokens[*current].value, "NOT") == 0 &&
+                      *current + 1 < buffer->count &&
+                      strcmp(buffer->tokens[*current + 1].value, "IN") == 0))
+            {
+                if (!parseInList(buffer, current))
+                {
+                    return false;
+                }
+            }
         }
 
         // Comparison operators
@@ -620,6 +886,7 @@ bool parseWhereClause(TokenBuffer *buffer, int *current)
                 (buffer->tokens[*current].type != TOKEN_STRING &&
                  buffer->tokens[*current].type != TOKEN_INTEGER &&
                  buffer->tokens[*current].type != TOKEN_FLOAT &&
+                 buffer->tokens[*current].type != TOKEN_PARAMETER &&
                  buffer->tokens[*current].type != TOKEN_IDENTIFIER))
             {
                 setError("Expected value after comparison operator",
@@ -670,6 +937,20 @@ void parseTokenBuffer(TokenBuffer *buffer)
                     return;
                 }
             }
+            else if (strcmp(token.value, "EXPLAIN") == 0)
+            {
+                if (!parseExplainStatement(buffer, &current))
+                {
+                    return;
+                }
+            }
+            else if (strcmp(token.value, "ANALYZE") == 0)
+            {
+                if (!parseAnalyzeStatement(buffer, &current))
+                {
+                    return;
+                }
+            }
             else
             {
                 setError("Unsupported SQL statement",
@@ -677,7 +958,11 @@ void parseTokenBuffer(TokenBuffer *buffer)
                 return;
             }
         }
-        else if (token.type != TOKEN_EOF)
+        else if (token.type == TOKEN_EOF)
+        {
+            break;
+        }
+        else
         {
             setError("Expected SQL statement",
                      token.line, token.column, token.value);
@@ -686,10 +971,54 @@ void parseTokenBuffer(TokenBuffer *buffer)
     }
 }
 
+// Table names are stored in MAX_NAME bytes; longer ones are an error
+// rather than silently truncated into a different name
+static bool checkTableName(SemanticContext *context, const char *name)
+{
+    if (strlen(name) < MAX_NAME)
+    {
+        return true;
+    }
+    char error[200];
+    snprintf(error, sizeof(error), "Table name too long (max %d characters): %.*s...",
+             MAX_NAME - 1, 32, name);
+    addSemanticError(context, error);
+    return false;
+}
+
+// The values of one IN list must share a type family; the '?' among them
+// take theirs from the rest
+static void checkInListTypes(SemanticContext *context, TokenBuffer *buffer, int open)
+{
+    DataType listType = TYPE_UNKNOWN;
+    for (int i = open + 1; i < buffer->count && strcmp(buffer->tokens[i].value, ")") != 0; i++)
+    {
+        DataType type = getTokenDataType(buffer->tokens[i].type);
+        if (type == TYPE_UNKNOWN)
+        {
+            continue;
+        }
+        if (!isTypeCompatible(listType, type))
+        {
+            char error[200];
+            snprintf(error, sizeof(error), "Type mismatch in IN list: %s value among %s values",
+                     DataTypeNames[type], DataTypeNames[listType]);
+            addSemanticError(context, error);
+            return;
+        }
+        if (listType == TYPE_UNKNOWN)
+        {
+            listType = type;
+        }
+    }
+}
+
 bool performSemanticAnalysis(TokenBuffer *buffer)
 {
     SemanticContext semanticContext;
     initSemanticContext(&semanticContext);
+    firstSemanticError[0] = '\0';
+    bool result = true;
 
     // Populate semantic context from token buffer
     // This is a simplified example, you'll need to enhance this
@@ -697,27 +1026,120 @@ bool performSemanticAnalysis(TokenBuffer *buffer)
     {
         Token token = buffer->tokens[i];
 
+        // Each statement is checked against its own tables and joins
+        if (token.type == TOKEN_SEMICOLON)
+        {
+            result = analyzeSemanticRules(&semanticContext) && result;
+            endStatementScope(&semanticContext);
+            continue;
+        }
+
         // Example: Add tables and columns
         if (token.type == TOKEN_KEYWORD && strcmp(token.value, "FROM") == 0 && i + 1 < buffer->count)
         {
             // Assuming next token is table name
-            Table *table = malloc(sizeof(Table));
-            strcpy(table->name, buffer->tokens[i + 1].value);
+            if (!checkTableName(&semanticContext, buffer->tokens[i + 1].value))
+            {
+                continue;
+            }
+            Table *table = compilerAlloc(sizeof(Table));
+            snprintf(table->name, sizeof(table->name), "%.*s", MAX_NAME - 1,
+                     buffer->tokens[i + 1].value);
             table->columnCount = 0; // You'll populate this from symbol table
 
             addTable(&semanticContext, table);
         }
+
+        if (token.type == TOKEN_KEYWORD && strcmp(token.value, "IN") == 0 &&
+            i + 1 < buffer->count && strcmp(buffer->tokens[i + 1].value, "(") == 0)
+        {
+            checkInListTypes(&semanticContext, buffer, i + 1);
+        }
+
+        // Joined tables and their ON conditions form the join graph
+        if (token.type == TOKEN_KEYWORD && strcmp(token.value, "JOIN") == 0 &&
+            i + 1 < buffer->count && buffer->tokens[i + 1].type == TOKEN_IDENTIFIER)
+        {
+            if (semanticContext.joinCount >= MAX_JOINS)
+            {
+                addSemanticError(&semanticContext, "Too many joins in statement");
+                continue;
+            }
+            if (!checkTableName(&semanticContext, buffer->tokens[i + 1].value))
+            {
+                continue;
+            }
+
+            Table *table = compilerAlloc(sizeof(Table));
+            snprintf(table->name, sizeof(table->name), "%.*s", MAX_NAME - 1,
+                     buffer->tokens[i + 1].value);
+            table->columnCount = 0;
+
+            Join *join = &semanticContext.joins[semanticContext.joinCount++];
+            join->leftTable[0] = '\0';
+            if (semanticContext.tableCount > 0)
+            {
+                snprintf(join->leftTable, sizeof(join->leftTable), "%s",
+                         semanticContext.tables[semanticContext.tableCount - 1]->name);
+            }
+            snprintf(join->rightTable, sizeof(join->rightTable), "%s", table->name);
+            strcpy(join->joinType, "INNER");
+            join->conditionCount = 0;
+
+            addTable(&semanticContext, table);
+
+            // ON a op b [AND c op d ...]
+            int j = i + 2;
+            if (j < buffer->count && strcmp(buffer->tokens[j].value, "ON") == 0)
+            {
+                j++;
+                while (j + 2 < buffer->count &&
+                       buffer->tokens[j].type == TOKEN_IDENTIFIER &&
+                       buffer->tokens[j + 1].type == TOKEN_OPERATOR &&
+                       join->conditionCount < MAX_CONDITIONS)
+                {
+                    Condition *condition = &join->conditions[join->conditionCount++];
+                    setColumnReference(&condition->left, buffer->tokens[j].value);
+                    setColumnReference(&condition->right, buffer->tokens[j + 2].value);
+                    snprintf(condition->operator, sizeof(condition->operator), "%.2s",
+                             buffer->tokens[j + 1].value);
+                    j += 3;
+
+                    if (j < buffer->count && strcmp(buffer->tokens[j].value, "AND") == 0)
+                    {
+                        j++;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                }
+            }
+        }
     }
 
-    bool result = analyzeSemanticRules(&semanticContext);
+    // A last statement without ';'
+    result = analyzeSemanticRules(&semanticContext) && result;
 
     // Print errors if any
     if (!result)
     {
-        printf("Semantic Analysis Errors:\n");
+        if (semanticContext.errorCount > 0)
+        {
+            snprintf(firstSemanticError, sizeof(firstSemanticError), "%s",
+                     semanticContext.errors[0]);
+        }
+        if (isTextOutput())
+        {
+            fprintf(compilerOutput, "Semantic Analysis Errors:\n");
+        }
         for (int i = 0; i < semanticContext.errorCount; i++)
         {
-            printf("- %s\n", semanticContext.errors[i]);
+            if (isTextOutput())
+            {
+                fprintf(compilerOutput, "- %s\n", semanticContext.errors[i]);
+            }
+            reportDiagnostic("semantic", 0, 0, semanticContext.errors[i]);
         }
     }
 
@@ -731,4 +1153,8 @@ void addTable(SemanticContext *context, Table *table)
     {
         context->tables[context->tableCount++] = table;
     }
+    else
+    {
+        compilerFree(table, sizeof(Table));
+    }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define PARSER_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "types.h"
 #include "semantic.h"
 #include "intermediary.h"
@@ -9,14 +10,19 @@
 void setError(const char* message, int line, int column, const char* context);
 const char* getErrorMessage();
 void clearError();
+void setMemoryBudget(size_t bytes);
+size_t getMemoryBudget();
 TokenBuffer* createTokenBuffer();
-void addTokenToBuffer(TokenBuffer* buffer, Token token);
+bool addTokenToBuffer(TokenBuffer* buffer, Token token);
 void freeTokenBuffer(TokenBuffer* buffer);
 void parseTokenBuffer(TokenBuffer* buffer);
 void addTable(SemanticContext* context, Table* table);
 bool parseColumnList(TokenBuffer* buffer, int* current);
 bool isSelectStatement(TokenBuffer* buffer, int* current);
 bool parseWhereClause(TokenBuffer* buffer, int* current);
+bool parseAnalyzeStatement(TokenBuffer* buffer, int* current);
+bool parseExplainStatement(TokenBuffer* buffer, int* current);
 bool performSemanticAnalysis(TokenBuffer* buffer);
+const char* getFirstSemanticError();
 
 #endif
\ No newline at end of file
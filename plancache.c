@@ -0,0 +1,650 @@
+#include "plancache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "semantic.h"
+#include "allocator.h"
+
+static PlanCacheEntry planCache[PLAN_CACHE_CAPACITY];
+static int planCacheCount = 0;
+static unsigned long planCacheTick = 0;
+static int planCacheHits = 0;
+static int planCacheMisses = 0;
+
+void initParameterList(ParameterList* list) {
+    list->parameters = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+void freeParameterList(ParameterList* list) {
+    for (int i = 0; i < list->count; i++) {
+        freeConstantList(list->parameters[i].list);
+    }
+    compilerFree(list->parameters, sizeof(QueryParameter) * list->capacity);
+    initParameterList(list);
+}
+
+static bool addParameter(ParameterList* list, const Token* token) {
+    if (list->count >= list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+        QueryParameter* parameters = compilerRealloc(list->parameters,
+                                                     sizeof(QueryParameter) * list->capacity,
+                                                     sizeof(QueryParameter) * capacity);
+        if (!parameters) {
+            return false;
+        }
+        list->parameters = parameters;
+        list->capacity = capacity;
+    }
+    QueryParameter* parameter = &list->parameters[list->count++];
+    parameter->type = token->type;
+    parameter->dataType = getTokenDataType(token->type);
+    parameter->isBound = token->type != TOKEN_PARAMETER;
+    strcpy(parameter->value, parameter->isBound ? token->value : "");
+    parameter->list = NULL;
+    return true;
+}
+
+static bool isLiteral(TokenType type) {
+    return type == TOKEN_STRING || type == TOKEN_INTEGER || type == TOKEN_FLOAT ||
+           type == TOKEN_PARAMETER;
+}
+
+// Number of values of "( literal, ... )" starting at open, or 0 unless
+// they are all literals of one type family
+static int measureInList(const TokenBuffer* buffer, int open, DataType* type, size_t* textSize) {
+    if (open >= buffer->count || strcmp(buffer->tokens[open].value, "(") != 0) {
+        return 0;
+    }
+
+    int values = 0;
+    bool strings = false, numbers = false, floats = false;
+    size_t text = 0;
+    for (int i = open + 1; i < buffer->count; i += 2) {
+        const Token* token = &buffer->tokens[i];
+        if (token->type == TOKEN_STRING) {
+            strings = true;
+            text += strlen(token->value);
+        } else if (token->type == TOKEN_INTEGER || token->type == TOKEN_FLOAT) {
+            numbers = true;
+            floats |= token->type == TOKEN_FLOAT;
+        } else {
+            return 0;
+        }
+        values++;
+
+        if (i + 1 >= buffer->count) {
+            return 0;
+        }
+        if (strcmp(buffer->tokens[i + 1].value, ")") == 0) {
+            if (strings && numbers) {
+                return 0;
+            }
+            *type = strings ? TYPE_VARCHAR : (floats ? TYPE_FLOAT : TYPE_INT);
+            *textSize = text;
+            return values;
+        }
+        if (strcmp(buffer->tokens[i + 1].value, ",") != 0) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+// Lifts an IN list of literals into one parameter slot holding them as a
+// ConstantList, leaving "( $n )" in the stream. Lists of any length then
+// share one program and take a single slot. Returns false when out of
+// memory; lists it cannot type are left for the per-literal pass.
+static bool collapseInList(TokenBuffer* buffer, int open, ParameterList* parameters,
+                           bool* collapsed) {
+    DataType type;
+    size_t textSize;
+    *collapsed = false;
+    int values = measureInList(buffer, open, &type, &textSize);
+    if (values == 0) {
+        return true;
+    }
+
+    ConstantList* list = createConstantList(type, values, textSize);
+    if (!list) {
+        return false;
+    }
+    for (int i = 0; i < values; i++) {
+        if (!addConstant(list, buffer->tokens[open + 1 + 2 * i].value)) {
+            freeConstantList(list);
+            return true;
+        }
+    }
+    if (!finishConstantList(list) || !addParameter(parameters, &buffer->tokens[open + 1])) {
+        freeConstantList(list);
+        return false;
+    }
+    QueryParameter* parameter = &parameters->parameters[parameters->count - 1];
+    parameter->list = list;
+    parameter->dataType = type;
+
+    Token* slot = &buffer->tokens[open + 1];
+    slot->type = type == TYPE_VARCHAR ? TOKEN_STRING : (type == TYPE_FLOAT ? TOKEN_FLOAT : TOKEN_INTEGER);
+    snprintf(slot->value, sizeof(slot->value), "$%d", parameters->count);
+
+    int close = open + 2 * values;
+    memmove(&buffer->tokens[open + 2], &buffer->tokens[close],
+            sizeof(Token) * (buffer->count - close));
+    buffer->count -= close - open - 2;
+    *collapsed = true;
+    return true;
+}
+
+// Replaces literals and '?' placeholders with parameter slots ($1, $2, ...)
+// so that queries differing only in their constants share one compiled
+// program. Row counts of LIMIT/OFFSET stay inline since they decide between
+// sort and Top-N.
+void normalizeTokenBuffer(TokenBuffer* buffer, ParameterList* parameters) {
+    for (int i = 0; i < buffer->count; i++) {
+        Token* token = &buffer->tokens[i];
+        if (token->type == TOKEN_KEYWORD && strcmp(token->value, "IN") == 0) {
+            bool collapsed;
+            if (!collapseInList(buffer, i + 1, parameters, &collapsed)) {
+                return;
+            }
+            if (collapsed) {
+                i += 3;
+            }
+            continue;
+        }
+        if (!isLiteral(token->type)) {
+            continue;
+        }
+        if (i > 0 && buffer->tokens[i - 1].type == TOKEN_KEYWORD &&
+            (strcmp(buffer->tokens[i - 1].value, "LIMIT") == 0 ||
+             strcmp(buffer->tokens[i - 1].value, "OFFSET") == 0)) {
+            continue;
+        }
+        if (!addParameter(parameters, token)) {
+            return;
+        }
+        snprintf(token->value, sizeof(token->value), "$%d", parameters->count);
+    }
+}
+
+// Data type of a value given on the command line or over a connection
+static DataType getValueDataType(const char* value) {
+    if (value[0] == '\'' || value[0] == '"') {
+        return TYPE_VARCHAR;
+    }
+
+    const char* p = value;
+    if (*p == '-') {
+        p++;
+    }
+    if (!isdigit((unsigned char)*p)) {
+        return TYPE_UNKNOWN;
+    }
+
+    bool hasDot = false;
+    for (; *p; p++) {
+        if (*p == '.' && !hasDot) {
+            hasDot = true;
+        } else if (!isdigit((unsigned char)*p)) {
+            return TYPE_UNKNOWN;
+        }
+    }
+    return hasDot ? TYPE_FLOAT : TYPE_INT;
+}
+
+// Binds a value to slot $slot, checking it against the type inferred for
+// the placeholder
+bool bindParameter(ParameterList* parameters, int slot, const char* value) {
+    if (slot < 1 || slot > parameters->count) {
+        return false;
+    }
+
+    QueryParameter* parameter = &parameters->parameters[slot - 1];
+    DataType valueType = getValueDataType(value);
+    if (valueType == TYPE_UNKNOWN) {
+        return false;
+    }
+
+    // Dates are written as string literals
+    DataType expected = parameter->dataType == TYPE_DATE ? TYPE_VARCHAR : parameter->dataType;
+    if (!isTypeCompatible(expected, valueType)) {
+        return false;
+    }
+
+    strncpy(parameter->value, value, MAX_TOKEN_LENGTH - 1);
+    parameter->value[MAX_TOKEN_LENGTH - 1] = '\0';
+    parameter->isBound = true;
+    return true;
+}
+
+int countUnboundParameters(const ParameterList* parameters) {
+    int unbound = 0;
+    for (int i = 0; i < parameters->count; i++) {
+        if (!parameters->parameters[i].isBound) {
+            unbound++;
+        }
+    }
+    return unbound;
+}
+
+void printParameters(const ParameterList* parameters) {
+    if (parameters->count == 0) {
+        return;
+    }
+    fprintf(compilerOutput, "\nParâmetros:\n");
+    for (int i = 0; i < parameters->count; i++) {
+        const QueryParameter* parameter = &parameters->parameters[i];
+        if (parameter->list) {
+            fprintf(compilerOutput, "$%d = lista com %d valor(es) distinto(s) (%s, %s)\n", i + 1,
+                   parameter->list->count, DataTypeNames[parameter->dataType],
+                   ProbeStrategyNames[parameter->list->probe]);
+            continue;
+        }
+        fprintf(compilerOutput, "$%d = %s (%s)\n", i + 1,
+               parameter->isBound ? parameter->value : "?",
+               DataTypeNames[parameter->dataType]);
+    }
+}
+
+// Token types and values of the normalized stream, used as the exact cache
+// key. size receives the allocated size.
+static char* buildPlanKey(const TokenBuffer* buffer, size_t* size) {
+    size_t length = 1;
+    for (int i = 0; i < buffer->count; i++) {
+        length += strlen(buffer->tokens[i].value) + 2;
+    }
+
+    *size = length;
+    char* key = compilerAlloc(length);
+    if (!key) {
+        return NULL;
+    }
+
+    char* out = key;
+    for (int i = 0; i < buffer->count; i++) {
+        size_t valueLength = strlen(buffer->tokens[i].value);
+        *out++ = (char)('A' + buffer->tokens[i].type);
+        memcpy(out, buffer->tokens[i].value, valueLength);
+        out += valueLength;
+        *out++ = '\x1f';
+    }
+    *out = '\0';
+    return key;
+}
+
+// 64-bit FNV-1a
+static unsigned long long hashPlanKey(const char* key) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (const unsigned char* p = (const unsigned char*)key; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+unsigned long long fingerprintTokenBuffer(const TokenBuffer* buffer) {
+    size_t keySize;
+    char* key = buildPlanKey(buffer, &keySize);
+    if (!key) {
+        return 0;
+    }
+    unsigned long long fingerprint = hashPlanKey(key);
+    compilerFree(key, keySize);
+    return fingerprint;
+}
+
+static PlanCacheEntry* findPlan(const char* key, unsigned long long fingerprint,
+                                unsigned int catalogVersion) {
+    for (int i = 0; i < planCacheCount; i++) {
+        PlanCacheEntry* entry = &planCache[i];
+        if (entry->fingerprint == fingerprint &&
+            entry->catalogVersion == catalogVersion &&
+            strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// On a hit, the cached program replaces the intermediate code context
+bool lookupPlan(const TokenBuffer* buffer, unsigned int catalogVersion) {
+    size_t keySize;
+    char* key = buildPlanKey(buffer, &keySize);
+    if (!key) {
+        return false;
+    }
+
+    PlanCacheEntry* entry = findPlan(key, hashPlanKey(key), catalogVersion);
+    compilerFree(key, keySize);
+
+    if (!entry) {
+        planCacheMisses++;
+        return false;
+    }
+
+    memcpy(intermediateCodeContext.instructions, entry->instructions,
+           sizeof(IntermediateCodeInstruction) * entry->instructionCount);
+    intermediateCodeContext.instructionCount = entry->instructionCount;
+    intermediateCodeContext.tempVarCounter = entry->tempVarCounter;
+    entry->lastUsed = ++planCacheTick;
+    planCacheHits++;
+    return true;
+}
+
+// Instruction arrays always hold at least one slot
+static size_t instructionBytes(int count) {
+    return sizeof(IntermediateCodeInstruction) * (count > 0 ? count : 1);
+}
+
+static void freePlanCacheEntry(PlanCacheEntry* entry) {
+    compilerFree(entry->key, entry->keySize);
+    compilerFree(entry->instructions, instructionBytes(entry->instructionCount));
+    entry->key = NULL;
+    entry->instructions = NULL;
+}
+
+// Takes ownership of key and instructions, evicting the least recently
+// used plan when the cache is full
+static void insertPlan(char* key, size_t keySize, unsigned long long fingerprint,
+                       unsigned int catalogVersion, IntermediateCodeInstruction* instructions,
+                       int count, int tempVarCounter) {
+    PlanCacheEntry* entry = findPlan(key, fingerprint, catalogVersion);
+    if (entry) {
+        freePlanCacheEntry(entry);
+    } else if (planCacheCount < PLAN_CACHE_CAPACITY) {
+        entry = &planCache[planCacheCount++];
+    } else {
+        entry = &planCache[0];
+        for (int i = 1; i < planCacheCount; i++) {
+            if (planCache[i].lastUsed < entry->lastUsed) {
+                entry = &planCache[i];
+            }
+        }
+        freePlanCacheEntry(entry);
+    }
+
+    entry->instructions = instructions;
+    entry->instructionCount = count;
+    entry->tempVarCounter = tempVarCounter;
+    entry->fingerprint = fingerprint;
+    entry->catalogVersion = catalogVersion;
+    entry->key = key;
+    entry->keySize = keySize;
+    entry->lastUsed = ++planCacheTick;
+}
+
+// Stores the current intermediate code
+void storePlan(const TokenBuffer* buffer, unsigned int catalogVersion) {
+    size_t keySize;
+    char* key = buildPlanKey(buffer, &keySize);
+    if (!key) {
+        return;
+    }
+
+    int count = intermediateCodeContext.instructionCount;
+    IntermediateCodeInstruction* instructions = compilerAlloc(instructionBytes(count));
+    if (!instructions) {
+        compilerFree(key, keySize);
+        return;
+    }
+    memcpy(instructions, intermediateCodeContext.instructions,
+           sizeof(IntermediateCodeInstruction) * count);
+
+    insertPlan(key, keySize, hashPlanKey(key), catalogVersion, instructions, count,
+               intermediateCodeContext.tempVarCounter);
+}
+
+void clearPlanCache(void) {
+    for (int i = 0; i < planCacheCount; i++) {
+        freePlanCacheEntry(&planCache[i]);
+    }
+    planCacheCount = 0;
+}
+
+int getPlanCacheHits(void) {
+    return planCacheHits;
+}
+
+int getPlanCacheMisses(void) {
+    return planCacheMisses;
+}
+
+// On-disk layout: PlanCacheFileHeader followed by entryCount records of
+// PlanCacheFileEntry, the key bytes and the instructions. The checksum
+// covers everything after the header.
+typedef struct {
+    char magic[8];
+    uint32_t formatVersion;
+    uint32_t instructionSize;
+    uint32_t tokenTypeCount;
+    uint32_t entryCount;
+    uint64_t checksum;
+} PlanCacheFileHeader;
+
+typedef struct {
+    uint64_t fingerprint;
+    uint32_t catalogVersion;
+    uint32_t keyLength;
+    int32_t instructionCount;
+    int32_t tempVarCounter;
+} PlanCacheFileEntry;
+
+static void initPlanCacheFileHeader(PlanCacheFileHeader* header) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, PLAN_CACHE_FILE_MAGIC, sizeof(header->magic));
+    header->formatVersion = PLAN_CACHE_FILE_VERSION;
+    header->instructionSize = sizeof(IntermediateCodeInstruction);
+    header->tokenTypeCount = TOKEN_ERROR + 1;
+}
+
+static uint64_t checksumBytes(const unsigned char* data, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool isTerminated(const char* text, size_t size) {
+    return memchr(text, '\0', size) != NULL;
+}
+
+// The checksum only catches accidents, so every field later printed or
+// used as an index is checked against a hand-made file too
+static bool isValidStoredPlan(const unsigned char* key, uint32_t keyLength,
+                              const unsigned char* stored, int32_t count, int32_t tempVarCounter) {
+    if (memchr(key, '\0', keyLength) != NULL || tempVarCounter < 0) {
+        return false;
+    }
+    for (int32_t i = 0; i < count; i++) {
+        IntermediateCodeInstruction instr;
+        memcpy(&instr, stored + (size_t)i * sizeof(instr), sizeof(instr));
+        int type = (int)instr.type;
+        if (type < IR_LOAD || type > IR_ANALYZE ||
+            !isTerminated(instr.result, sizeof(instr.result)) ||
+            !isTerminated(instr.op1, sizeof(instr.op1)) ||
+            !isTerminated(instr.op2, sizeof(instr.op2)) ||
+            !isTerminated(instr.operation, sizeof(instr.operation))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Loads plans saved by savePlanCache. Files from another format version or
+// build layout, or that fail validation, are ignored as a whole.
+bool loadPlanCache(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(PlanCacheFileHeader)) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = (size_t)info.st_size;
+    unsigned char* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    PlanCacheFileHeader expected;
+    PlanCacheFileHeader header;
+    initPlanCacheFileHeader(&expected);
+    memcpy(&header, data, sizeof(header));
+
+    bool valid = memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+                 header.formatVersion == expected.formatVersion &&
+                 header.instructionSize == expected.instructionSize &&
+                 header.tokenTypeCount == expected.tokenTypeCount &&
+                 header.checksum == checksumBytes(data + sizeof(header), size - sizeof(header));
+
+    // First pass: every record must lie within the file before any is used
+    size_t offset = sizeof(header);
+    for (uint32_t i = 0; valid && i < header.entryCount; i++) {
+        PlanCacheFileEntry record;
+        if (size - offset < sizeof(record)) {
+            valid = false;
+            break;
+        }
+        memcpy(&record, data + offset, sizeof(record));
+        offset += sizeof(record);
+
+        size_t storedBytes = (size_t)record.instructionCount * sizeof(IntermediateCodeInstruction);
+        if (record.instructionCount < 0 || record.instructionCount > MAX_INTERMEDIATE_CODE ||
+            size - offset < (size_t)record.keyLength + storedBytes ||
+            !isValidStoredPlan(data + offset, record.keyLength, data + offset + record.keyLength,
+                               record.instructionCount, record.tempVarCounter)) {
+            valid = false;
+            break;
+        }
+        offset += record.keyLength + storedBytes;
+    }
+
+    // Second pass: copy every plan out of the mapping, and only insert them
+    // once all copies exist, so the cache is never left half loaded
+    PlanCacheEntry* loaded = NULL;
+    size_t loadedBytes = sizeof(PlanCacheEntry) * header.entryCount;
+    uint32_t loadedCount = 0;
+    if (valid && header.entryCount > 0) {
+        loaded = compilerAlloc(loadedBytes);
+        valid = loaded != NULL;
+    }
+
+    offset = sizeof(header);
+    for (uint32_t i = 0; valid && i < header.entryCount; i++) {
+        PlanCacheFileEntry record;
+        memcpy(&record, data + offset, sizeof(record));
+        offset += sizeof(record);
+
+        PlanCacheEntry* entry = &loaded[loadedCount];
+        entry->keySize = (size_t)record.keyLength + 1;
+        entry->key = compilerAlloc(entry->keySize);
+        entry->instructions = compilerAlloc(instructionBytes(record.instructionCount));
+        if (!entry->key || !entry->instructions) {
+            compilerFree(entry->key, entry->keySize);
+            compilerFree(entry->instructions, instructionBytes(record.instructionCount));
+            valid = false;
+            break;
+        }
+        memcpy(entry->key, data + offset, record.keyLength);
+        entry->key[record.keyLength] = '\0';
+        offset += record.keyLength;
+
+        size_t storedBytes = (size_t)record.instructionCount * sizeof(IntermediateCodeInstruction);
+        memcpy(entry->instructions, data + offset, storedBytes);
+        offset += storedBytes;
+
+        entry->instructionCount = record.instructionCount;
+        entry->tempVarCounter = record.tempVarCounter;
+        entry->fingerprint = record.fingerprint;
+        entry->catalogVersion = record.catalogVersion;
+        loadedCount++;
+    }
+
+    for (uint32_t i = 0; i < loadedCount; i++) {
+        PlanCacheEntry* entry = &loaded[i];
+        if (valid) {
+            insertPlan(entry->key, entry->keySize, entry->fingerprint, entry->catalogVersion,
+                       entry->instructions, entry->instructionCount, entry->tempVarCounter);
+        } else {
+            freePlanCacheEntry(entry);
+        }
+    }
+    compilerFree(loaded, loadedBytes);
+
+    munmap(data, size);
+    return valid;
+}
+
+// Writes every cached plan to path, replacing the file atomically
+bool savePlanCache(const char* path) {
+    size_t size = sizeof(PlanCacheFileHeader);
+    for (int i = 0; i < planCacheCount; i++) {
+        size += sizeof(PlanCacheFileEntry) + strlen(planCache[i].key) +
+                (size_t)planCache[i].instructionCount * sizeof(IntermediateCodeInstruction);
+    }
+
+    unsigned char* data = compilerAlloc(size);
+    if (!data) {
+        return false;
+    }
+    memset(data, 0, size);
+
+    PlanCacheFileHeader header;
+    initPlanCacheFileHeader(&header);
+    header.entryCount = (uint32_t)planCacheCount;
+
+    size_t offset = sizeof(header);
+    for (int i = 0; i < planCacheCount; i++) {
+        PlanCacheEntry* entry = &planCache[i];
+        PlanCacheFileEntry record;
+        memset(&record, 0, sizeof(record));
+        record.fingerprint = entry->fingerprint;
+        record.catalogVersion = entry->catalogVersion;
+        record.keyLength = (uint32_t)strlen(entry->key);
+        record.instructionCount = entry->instructionCount;
+        record.tempVarCounter = entry->tempVarCounter;
+
+        memcpy(data + offset, &record, sizeof(record));
+        offset += sizeof(record);
+        memcpy(data + offset, entry->key, record.keyLength);
+        offset += record.keyLength;
+        memcpy(data + offset, entry->instructions,
+               (size_t)entry->instructionCount * sizeof(IntermediateCodeInstruction));
+        offset += (size_t)entry->instructionCount * sizeof(IntermediateCodeInstruction);
+    }
+
+    header.checksum = checksumBytes(data + sizeof(header), size - sizeof(header));
+    memcpy(data, &header, sizeof(header));
+
+    char tempPath[4096];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+
+    FILE* file = fopen(tempPath, "wb");
+    if (!file) {
+        compilerFree(data, size);
+        return false;
+    }
+    bool written = fwrite(data, 1, size, file) == size;
+    written = fclose(file) == 0 && written;
+    compilerFree(data, size);
+
+    if (!written || rename(tempPath, path) != 0) {
+        remove(tempPath);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef PLANCACHE_H
+#define PLANCACHE_H
+
+#include <stdbool.h>
+#include "types.h"
+#include "intermediary.h"
+#include "inlist.h"
+
+#define PLAN_CACHE_CAPACITY 64
+#define PLAN_CACHE_FILE_MAGIC "SQLCPLAN"
+#define PLAN_CACHE_FILE_VERSION 1
+
+// Literal lifted out of the query text by the normalizer, a whole IN list
+// of literals, or a '?' placeholder waiting for a value
+typedef struct {
+    TokenType type;
+    DataType dataType;
+    bool isBound;
+    char value[MAX_TOKEN_LENGTH];
+    ConstantList* list;     // Values of a collapsed IN list, else NULL
+} QueryParameter;
+
+typedef struct {
+    QueryParameter* parameters;
+    int count;
+    int capacity;
+} ParameterList;
+
+// Compiled program for one normalized query shape
+typedef struct {
+    unsigned long long fingerprint;
+    unsigned int catalogVersion;
+    char* key;
+    size_t keySize;
+    IntermediateCodeInstruction* instructions;
+    int instructionCount;
+    int tempVarCounter;
+    unsigned long lastUsed;
+} PlanCacheEntry;
+
+void initParameterList(ParameterList* list);
+void freeParameterList(ParameterList* list);
+void normalizeTokenBuffer(TokenBuffer* buffer, ParameterList* parameters);
+bool bindParameter(ParameterList* parameters, int slot, const char* value);
+int countUnboundParameters(const ParameterList* parameters);
+void printParameters(const ParameterList* parameters);
+unsigned long long fingerprintTokenBuffer(const TokenBuffer* buffer);
+
+bool lookupPlan(const TokenBuffer* buffer, unsigned int catalogVersion);
+void storePlan(const TokenBuffer* buffer, unsigned int catalogVersion);
+void clearPlanCache(void);
+bool loadPlanCache(const char* path);
+bool savePlanCache(const char* path);
+int getPlanCacheHits(void);
+int getPlanCacheMisses(void);
+
+#endif
@@ -0,0 +1,8 @@
+SOURCES="lexico.c parser.c semantic.c intermediary.c plancache.c stats.c output.c allocator.c inlist.c lexchunks.c incremental.c"
+FLAGS="-Wall -Wextra -fsanitize=address -g -fsanitize=undefined -Werror -pthread -lm"
+status=0
+for test in tests/*_test.c; do
+    gcc "$test" $SOURCES -o "${test%.c}" $FLAGS && "./${test%.c}" || status=1
+    rm -f "${test%.c}"
+done
+exit $status
@@ -1,6 +1,15 @@
 #include "semantic.h"
 #include <string.h>
 #include <stdlib.h>
+#include "allocator.h"
+
+// Version of the table definitions that compiled programs depend on.
+// Nothing changes the catalog yet, so it stays constant.
+static unsigned int catalogVersion = 1;
+
+unsigned int getCatalogVersion(void) {
+    return catalogVersion;
+}
 
 void initSemanticContext(SemanticContext* context) {
     context->tableCount = 0;
@@ -10,6 +19,14 @@ void initSemanticContext(SemanticContext* context) {
     context->errorCount = 0;
 }
 
+const char* DataTypeNames[] = {
+    "INT",
+    "FLOAT",
+    "VARCHAR",
+    "DATE",
+    "UNKNOWN"
+};
+
 DataType getTokenDataType(TokenType type) {
     switch(type) {
         case TOKEN_INTEGER: return TYPE_INT;
@@ -33,6 +50,29 @@ Column* findColumn(SemanticContext* context, const char* tableName, const char*
     return NULL;
 }
 
+Table* findTable(SemanticContext* context, const char* tableName) {
+    for (int i = 0; i < context->tableCount; i++) {
+        if (strcmp(context->tables[i]->name, tableName) == 0) {
+            return context->tables[i];
+        }
+    }
+    return NULL;
+}
+
+// Splits "table.column" (or a bare column) into a column reference
+void setColumnReference(ColumnReference* ref, const char* text) {
+    const char* dot = strchr(text, '.');
+    ref->tableName[0] = '\0';
+    if (dot && dot - text < MAX_NAME) {
+        memcpy(ref->tableName, text, dot - text);
+        ref->tableName[dot - text] = '\0';
+        text = dot + 1;
+    }
+    strncpy(ref->columnName, text, MAX_NAME - 1);
+    ref->columnName[MAX_NAME - 1] = '\0';
+    ref->resolvedColumn = NULL;
+}
+
 bool isTypeCompatible(DataType type1, DataType type2) {
     if (type1 == TYPE_UNKNOWN || type2 == TYPE_UNKNOWN) return true;
     if (type1 == type2) return true;
@@ -41,15 +81,119 @@ bool isTypeCompatible(DataType type1, DataType type2) {
     return false;
 }
 
+// Slot number of a normalized literal or placeholder ("$n"), or 0
+static int getParameterSlot(const Token* token) {
+    if (token->value[0] != '$') {
+        return 0;
+    }
+    return atoi(token->value + 1);
+}
+
+// Type of a parameter slot or literal, as far as it is known
+static DataType getValueType(const Token* token, const ParameterList* parameters) {
+    int slot = getParameterSlot(token);
+    if (slot > 0 && slot <= parameters->count) {
+        return parameters->parameters[slot - 1].dataType;
+    }
+    return getTokenDataType(token->type);
+}
+
+// Type shared by the other values of the IN list around position i:
+// FLOAT if integers and reals mix, UNKNOWN outside a list, when there are
+// no other values or when strings and numbers mix
+static DataType inferInListType(const TokenBuffer* buffer, int i, const ParameterList* parameters) {
+    const Token* tokens = buffer->tokens;
+    int open = i - 1;
+    while (open >= 1 && strcmp(tokens[open].value, ",") == 0) {
+        open -= 2;
+    }
+    if (open < 1 || strcmp(tokens[open].value, "(") != 0 ||
+        strcmp(tokens[open - 1].value, "IN") != 0) {
+        return TYPE_UNKNOWN;
+    }
+
+    DataType type = TYPE_UNKNOWN;
+    for (int j = open + 1; j < buffer->count && strcmp(tokens[j].value, ")") != 0; j++) {
+        if (tokens[j].type == TOKEN_PARAMETER || tokens[j].type == TOKEN_DELIMITER) {
+            continue;
+        }
+        DataType value = getValueType(&tokens[j], parameters);
+        if (type == TYPE_UNKNOWN || (type == TYPE_INT && value == TYPE_FLOAT)) {
+            type = value;
+        } else if (!isTypeCompatible(type, value)) {
+            return TYPE_UNKNOWN;
+        }
+    }
+    return type;
+}
+
+// Type a '?' placeholder takes from what it is compared with
+static DataType inferPlaceholderType(const TokenBuffer* buffer, int i,
+                                     const ParameterList* parameters) {
+    const Token* tokens = buffer->tokens;
+    int partner = -1;
+
+    // BETWEEN ? AND x / BETWEEN x AND ?
+    if (i >= 1 && strcmp(tokens[i - 1].value, "BETWEEN") == 0 && i + 2 < buffer->count) {
+        partner = i + 2;
+    } else if (i >= 3 && strcmp(tokens[i - 1].value, "AND") == 0 &&
+               strcmp(tokens[i - 3].value, "BETWEEN") == 0) {
+        partner = i - 2;
+    }
+    if (partner >= 0) {
+        int slot = getParameterSlot(&tokens[partner]);
+        if (slot > 0 && slot <= parameters->count) {
+            return parameters->parameters[slot - 1].dataType;
+        }
+        return getTokenDataType(tokens[partner].type);
+    }
+
+    // AGG(column) <op> ?
+    if (i >= 5 && tokens[i - 1].type == TOKEN_OPERATOR &&
+        strcmp(tokens[i - 2].value, ")") == 0) {
+        switch (getAggregateFunction(tokens[i - 5].value)) {
+            case AGG_COUNT: return TYPE_INT;
+            case AGG_AVG: return TYPE_FLOAT;
+            default: break;
+        }
+    }
+
+    // x IN (1, ?, 3)
+    if (i >= 2) {
+        DataType listType = inferInListType(buffer, i, parameters);
+        if (listType != TYPE_UNKNOWN) {
+            return listType;
+        }
+    }
+
+    // Column types are unknown without a catalog
+    return TYPE_UNKNOWN;
+}
+
+// Gives each placeholder slot the type implied by its context
+void inferParameterTypes(const TokenBuffer* buffer, ParameterList* parameters) {
+    for (int i = 0; i < buffer->count; i++) {
+        if (buffer->tokens[i].type != TOKEN_PARAMETER) {
+            continue;
+        }
+        int slot = getParameterSlot(&buffer->tokens[i]);
+        if (slot > 0 && slot <= parameters->count) {
+            parameters->parameters[slot - 1].dataType =
+                inferPlaceholderType(buffer, i, parameters);
+        }
+    }
+}
+
 void addSemanticError(SemanticContext* context, const char* error) {
     if (context->errorCount < 100) {
-        context->errors[context->errorCount] = strdup(error);
+        context->errors[context->errorCount] = compilerStrdup(error);
         context->errorCount++;
     }
 }
 
 bool analyzeSemanticRules(SemanticContext* context) {
-    bool isValid = true;
+    // Errors recorded while the context was being built count too
+    bool isValid = context->errorCount == 0;
 
     // Example: Validate projections
     for (int i = 0; i < context->projectionCount; i++) {
@@ -65,16 +209,46 @@ bool analyzeSemanticRules(SemanticContext* context) {
         }
     }
 
+    // Join conditions may only reference tables in scope
+    for (int i = 0; i < context->joinCount; i++) {
+        Join* join = &context->joins[i];
+        for (int j = 0; j < join->conditionCount; j++) {
+            ColumnReference* sides[2] = { &join->conditions[j].left, &join->conditions[j].right };
+            for (int k = 0; k < 2; k++) {
+                if (sides[k]->tableName[0] != '\0' &&
+                    findTable(context, sides[k]->tableName) == NULL) {
+                    char error[200];
+                    snprintf(error, sizeof(error), "Unknown table in join condition: %s.%s",
+                             sides[k]->tableName, sides[k]->columnName);
+                    addSemanticError(context, error);
+                    isValid = false;
+                }
+            }
+        }
+    }
+
     // Add more semantic validation rules here
     return isValid;
 }
 
+// Tables, joins and references are scoped to one statement; errors are
+// kept for the whole analysis
+void endStatementScope(SemanticContext* context) {
+    for (int i = 0; i < context->tableCount; i++) {
+        compilerFree(context->tables[i], sizeof(Table));
+    }
+    context->tableCount = 0;
+    context->joinCount = 0;
+    context->projectionCount = 0;
+    context->whereConditionCount = 0;
+}
+
 void freeSemanticContext(SemanticContext* context) {
     for (int i = 0; i < context->errorCount; i++) {
-        free(context->errors[i]);
+        compilerFree(context->errors[i], strlen(context->errors[i]) + 1);
     }
 
     for (int i = 0; i < context->tableCount; i++) {
-        free(context->tables[i]);
+        compilerFree(context->tables[i], sizeof(Table));
     }
 }
\ No newline at end of file
@@ -3,9 +3,18 @@
 
 #include "compiler.h"
 #include "types.h"
+#include "plancache.h"
 
+unsigned int getCatalogVersion(void);
 void initSemanticContext(SemanticContext* context);
+DataType getTokenDataType(TokenType type);
+bool isTypeCompatible(DataType type1, DataType type2);
+void inferParameterTypes(const TokenBuffer* buffer, ParameterList* parameters);
 bool analyzeSemanticRules(SemanticContext* context);
+Table* findTable(SemanticContext* context, const char* tableName);
+void setColumnReference(ColumnReference* ref, const char* text);
+void addSemanticError(SemanticContext* context, const char* error);
+void endStatementScope(SemanticContext* context);
 void freeSemanticContext(SemanticContext* context);
 
 #endif
\ No newline at end of file
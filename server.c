@@ -0,0 +1,392 @@
+#define _GNU_SOURCE
+#include "server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "compiler.h"
+
+typedef struct {
+    int fd;
+    unsigned char* in;
+    size_t inLength;
+    size_t inCapacity;
+    unsigned char* out;
+    size_t outLength;
+    size_t outSent;
+} ClientConnection;
+
+static volatile sig_atomic_t serverStopping = 0;
+
+static void stopServer(int signal) {
+    (void)signal;
+    serverStopping = 1;
+}
+
+static uint32_t readLength(const unsigned char* bytes) {
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+           ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+}
+
+static void writeLength(unsigned char* bytes, uint32_t length) {
+    bytes[0] = (unsigned char)(length >> 24);
+    bytes[1] = (unsigned char)(length >> 16);
+    bytes[2] = (unsigned char)(length >> 8);
+    bytes[3] = (unsigned char)length;
+}
+
+static void closeClient(ClientConnection* client) {
+    close(client->fd);
+    free(client->in);
+    free(client->out);
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+}
+
+static bool reserve(unsigned char** buffer, size_t* capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return true;
+    }
+    size_t newCapacity = *capacity ? *capacity : 4096;
+    while (newCapacity < needed) {
+        newCapacity *= 2;
+    }
+    unsigned char* grown = realloc(*buffer, newCapacity);
+    if (!grown) {
+        return false;
+    }
+    *buffer = grown;
+    *capacity = newCapacity;
+    return true;
+}
+
+// Compiles one request with the warm catalog and plan cache, queuing the
+// output as the response. The length header is reserved at the front of
+// the output stream so an idle connection can take the buffer as is.
+static bool handleRequest(ClientConnection* client, const unsigned char* sql, uint32_t length) {
+    static const char emptyRequest[] = " ";
+    static const unsigned char header[4] = {0};
+    char* response = NULL;
+    size_t responseLength = 0;
+
+    FILE* output = open_memstream(&response, &responseLength);
+    FILE* input = length > 0 ? fmemopen((void*)sql, length, "r")
+                             : fmemopen((void*)emptyRequest, 1, "r");
+    if (!output || !input) {
+        if (output) fclose(output);
+        if (input) fclose(input);
+        free(response);
+        return false;
+    }
+    fwrite(header, 1, sizeof(header), output);
+
+    FILE* previousOutput = compilerOutput;
+    compilerOutput = output;
+    compileSQLStream(input, "<socket>");
+    compilerOutput = previousOutput;
+    fclose(input);
+    fclose(output);
+
+    if (responseLength - sizeof(header) > UINT32_MAX) {
+        free(response);
+        return false;
+    }
+    writeLength((unsigned char*)response, (uint32_t)(responseLength - sizeof(header)));
+
+    if (client->outLength == 0) {
+        free(client->out);
+        client->out = (unsigned char*)response;
+        client->outLength = responseLength;
+        return true;
+    }
+
+    size_t outCapacity = client->outLength;
+    bool queued = reserve(&client->out, &outCapacity, client->outLength + responseLength);
+    if (queued) {
+        memcpy(client->out + client->outLength, response, responseLength);
+        client->outLength += responseLength;
+    }
+    free(response);
+    return queued;
+}
+
+static size_t pendingOutput(const ClientConnection* client) {
+    return client->outLength - client->outSent;
+}
+
+// Answers the complete requests buffered so far. A client that does not
+// read its responses stops being served once SERVER_MAX_PENDING_OUTPUT
+// bytes are queued; the rest waits in the buffer until it catches up.
+static bool answerRequests(ClientConnection* client) {
+    size_t offset = 0;
+    while (client->inLength - offset >= 4 && pendingOutput(client) < SERVER_MAX_PENDING_OUTPUT) {
+        uint32_t length = readLength(client->in + offset);
+        if (length > SERVER_MAX_REQUEST) {
+            return false;
+        }
+        if (client->inLength - offset - 4 < length) {
+            break;
+        }
+        if (!handleRequest(client, client->in + offset + 4, length)) {
+            return false;
+        }
+        offset += 4 + length;
+    }
+
+    memmove(client->in, client->in + offset, client->inLength - offset);
+    client->inLength -= offset;
+    return true;
+}
+
+// Reads what is available and answers every complete request
+static bool readFromClient(ClientConnection* client) {
+    if (!reserve(&client->in, &client->inCapacity, client->inLength + 65536)) {
+        return false;
+    }
+
+    ssize_t received = read(client->fd, client->in + client->inLength,
+                            client->inCapacity - client->inLength);
+    if (received == 0) {
+        return false;
+    }
+    if (received < 0) {
+        return errno == EAGAIN || errno == EINTR;
+    }
+    client->inLength += (size_t)received;
+    return answerRequests(client);
+}
+
+static bool writeToClient(ClientConnection* client) {
+    ssize_t sent = write(client->fd, client->out + client->outSent, pendingOutput(client));
+    if (sent < 0) {
+        return errno == EAGAIN || errno == EINTR;
+    }
+    client->outSent += (size_t)sent;
+    if (client->outSent == client->outLength) {
+        client->outSent = 0;
+        client->outLength = 0;
+    }
+    return answerRequests(client);
+}
+
+static int openServerSocket(const char* socketPath) {
+    struct sockaddr_un address;
+    if (strlen(socketPath) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socketPath);
+    unlink(socketPath);
+
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// Serves clients until SIGINT/SIGTERM. Compilations run one at a time on
+// the shared compiler state; connections are multiplexed with poll().
+int runServer(const char* socketPath) {
+    int listenFd = openServerSocket(socketPath);
+    if (listenFd < 0) {
+        printf("Erro: não foi possível escutar em '%s': %s\n", socketPath, strerror(errno));
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stopServer;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    static ClientConnection clients[SERVER_MAX_CLIENTS];
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        memset(&clients[i], 0, sizeof(clients[i]));
+        clients[i].fd = -1;
+    }
+
+    printf("Servidor aguardando conexões em %s\n", socketPath);
+    fflush(stdout);
+
+    struct pollfd fds[SERVER_MAX_CLIENTS + 1];
+    int slots[SERVER_MAX_CLIENTS + 1];
+
+    while (!serverStopping) {
+        int count = 0;
+        fds[count].fd = listenFd;
+        fds[count].events = POLLIN;
+        slots[count++] = -1;
+
+        for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+            if (clients[i].fd >= 0) {
+                fds[count].fd = clients[i].fd;
+                bool backlogged = pendingOutput(&clients[i]) >= SERVER_MAX_PENDING_OUTPUT;
+                fds[count].events = (backlogged ? 0 : POLLIN) |
+                                    (clients[i].outLength > 0 ? POLLOUT : 0);
+                slots[count++] = i;
+            }
+        }
+
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int clientFd;
+            while ((clientFd = accept(listenFd, NULL, NULL)) >= 0) {
+                int slot = 0;
+                while (slot < SERVER_MAX_CLIENTS && clients[slot].fd >= 0) {
+                    slot++;
+                }
+                if (slot == SERVER_MAX_CLIENTS) {
+                    close(clientFd);
+                    continue;
+                }
+                fcntl(clientFd, F_SETFL, fcntl(clientFd, F_GETFL) | O_NONBLOCK);
+                clients[slot].fd = clientFd;
+            }
+        }
+
+        for (int i = 1; i < count; i++) {
+            ClientConnection* client = &clients[slots[i]];
+            bool open = true;
+
+            if (fds[i].revents & (POLLERR | POLLNVAL)) {
+                open = false;
+            }
+            if (open && (fds[i].revents & POLLOUT)) {
+                open = writeToClient(client);
+            }
+            if (open && (fds[i].revents & (POLLIN | POLLHUP))) {
+                open = readFromClient(client);
+            }
+            if (!open) {
+                closeClient(client);
+            }
+        }
+    }
+
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) {
+            closeClient(&clients[i]);
+        }
+    }
+    close(listenFd);
+    unlink(socketPath);
+    printf("Servidor encerrado\n");
+    return 0;
+}
+
+static bool sendAll(int fd, const void* data, size_t length) {
+    const unsigned char* bytes = data;
+    while (length > 0) {
+        ssize_t sent = write(fd, bytes, length);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += sent;
+        length -= (size_t)sent;
+    }
+    return true;
+}
+
+static bool receiveAll(int fd, void* data, size_t length) {
+    unsigned char* bytes = data;
+    while (length > 0) {
+        ssize_t received = read(fd, bytes, length);
+        if (received <= 0) {
+            if (received < 0 && errno == EINTR) continue;
+            return false;
+        }
+        bytes += received;
+        length -= (size_t)received;
+    }
+    return true;
+}
+
+// Sends one file to a running server and prints the response
+int runClient(const char* socketPath, const char* filename) {
+    FILE* input = fopen(filename, "rb");
+    if (!input) {
+        printf("Erro: Não foi possível abrir o arquivo '%s'\n", filename);
+        return 1;
+    }
+
+    // One byte past the limit tells an oversized file from one that fits
+    unsigned char* request = malloc(4 + SERVER_MAX_REQUEST + 1);
+    if (!request) {
+        fclose(input);
+        return 1;
+    }
+    size_t length = fread(request + 4, 1, SERVER_MAX_REQUEST + 1, input);
+    bool readFailed = ferror(input);
+    fclose(input);
+    if (readFailed || length > SERVER_MAX_REQUEST) {
+        if (readFailed) {
+            printf("Erro: falha ao ler o arquivo '%s'\n", filename);
+        } else {
+            printf("Erro: o arquivo '%s' excede o limite de %d bytes por requisição\n",
+                   filename, SERVER_MAX_REQUEST);
+        }
+        free(request);
+        return 1;
+    }
+    writeLength(request, (uint32_t)length);
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        printf("Erro: não foi possível conectar a '%s': %s\n", socketPath, strerror(errno));
+        if (fd >= 0) close(fd);
+        free(request);
+        return 1;
+    }
+
+    unsigned char header[4];
+    bool ok = sendAll(fd, request, 4 + length) && receiveAll(fd, header, sizeof(header));
+    free(request);
+
+    char* response = NULL;
+    uint32_t responseLength = ok ? readLength(header) : 0;
+    if (ok) {
+        response = malloc(responseLength > 0 ? responseLength : 1);
+        ok = response && receiveAll(fd, response, responseLength);
+    }
+    close(fd);
+
+    if (!ok) {
+        printf("Erro: resposta incompleta do servidor\n");
+        free(response);
+        return 1;
+    }
+
+    fwrite(response, 1, responseLength, stdout);
+    free(response);
+    return 0;
+}
@@ -0,0 +1,16 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdbool.h>
+
+#define SERVER_MAX_CLIENTS 256
+#define SERVER_MAX_REQUEST (16 * 1024 * 1024)
+#define SERVER_MAX_PENDING_OUTPUT (64 * 1024 * 1024)  // Per client, before reads pause
+
+// Protocol: every message, in both directions, is a 4-byte big-endian
+// length followed by that many bytes. Requests carry SQL text; responses
+// carry the compiler output for it.
+int runServer(const char* socketPath);
+int runClient(const char* socketPath, const char* filename);
+
+#endif
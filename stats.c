@@ -0,0 +1,283 @@
+#include "stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+#include "lexico.h"
+#include "plancache.h"
+#include "allocator.h"
+
+const char* CompilePhaseNames[] = {
+    "lexical",
+    "normalize",
+    "syntactic",
+    "semantic",
+    "intermediate"
+};
+
+const char* HardwareCounterNames[] = {
+    "cycles",
+    "instructions",
+    "cache_misses",
+    "branch_misses"
+};
+
+static CompileStats compileStats;
+static int counterFds[COUNTER_COUNT] = {-1, -1, -1, -1};
+static unsigned long long phaseCounterStart[COUNTER_COUNT];
+static bool countersRequested = false;
+static int activePhase = -1;
+static size_t liveBytes = 0;
+static size_t queryPeakBytes = 0;
+static struct timespec phaseWallStart;
+static struct timespec phaseCpuStart;
+
+static double elapsedSeconds(const struct timespec* start, const struct timespec* end) {
+    return (double)(end->tv_sec - start->tv_sec) +
+           (double)(end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+#ifdef __linux__
+static const unsigned long long counterConfigs[COUNTER_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+#endif
+
+// Opens one user-space counter per event for this process. Threads started
+// later, such as the --lex-threads workers, are inherited: their counts are
+// folded in when they exit, which is before the phase that joins them ends.
+// Events the kernel, hardware or sandbox refuse stay unavailable and read
+// as zero.
+bool enableHardwareCounters(void) {
+    bool any = false;
+    countersRequested = true;
+#ifdef __linux__
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (counterFds[i] >= 0) {
+            any = true;
+            continue;
+        }
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = counterConfigs[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = 1;
+        counterFds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        any = any || counterFds[i] >= 0;
+    }
+#endif
+    return any;
+}
+
+void disableHardwareCounters(void) {
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        if (counterFds[i] >= 0) {
+            close(counterFds[i]);
+            counterFds[i] = -1;
+        }
+    }
+}
+
+bool isHardwareCounterAvailable(HardwareCounter counter) {
+    return counterFds[counter] >= 0;
+}
+
+static void readCounters(unsigned long long values[COUNTER_COUNT]) {
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        values[i] = 0;
+        if (counterFds[i] >= 0 && read(counterFds[i], &values[i], sizeof(values[i])) != sizeof(values[i])) {
+            values[i] = 0;
+        }
+    }
+}
+
+// Phases do not nest; starting one closes whichever is still open
+void beginPhase(CompilePhase phase) {
+    endActivePhase();
+    activePhase = phase;
+    PhaseStats* stats = &compileStats.phases[phase];
+    if (liveBytes > stats->peakBytes) {
+        stats->peakBytes = liveBytes;
+    }
+    readCounters(phaseCounterStart);
+    clock_gettime(CLOCK_MONOTONIC, &phaseWallStart);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &phaseCpuStart);
+}
+
+void endPhase(CompilePhase phase) {
+    if (activePhase != (int)phase) {
+        return;
+    }
+
+    struct timespec wallEnd, cpuEnd;
+    unsigned long long counterEnd[COUNTER_COUNT];
+    clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpuEnd);
+    readCounters(counterEnd);
+
+    PhaseStats* stats = &compileStats.phases[phase];
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        stats->counters[i] += counterEnd[i] - phaseCounterStart[i];
+    }
+    stats->wallSeconds += elapsedSeconds(&phaseWallStart, &wallEnd);
+    stats->cpuSeconds += elapsedSeconds(&phaseCpuStart, &cpuEnd);
+    stats->runs++;
+    activePhase = -1;
+}
+
+void endActivePhase(void) {
+    if (activePhase >= 0) {
+        endPhase((CompilePhase)activePhase);
+    }
+}
+
+// Called by the counting allocator, which the tracking one wraps, after each
+// successful allocation or realloc; bytes are charged to the running phase.
+// The system allocator bypasses it, so its phases report no allocations.
+void recordAllocation(size_t bytes) {
+    liveBytes += bytes;
+    if (liveBytes > queryPeakBytes) {
+        queryPeakBytes = liveBytes;
+    }
+    if (activePhase < 0) {
+        return;
+    }
+    PhaseStats* stats = &compileStats.phases[activePhase];
+    stats->allocations++;
+    stats->bytesAllocated += bytes;
+    if (liveBytes > stats->peakBytes) {
+        stats->peakBytes = liveBytes;
+    }
+}
+
+void recordRelease(size_t bytes) {
+    liveBytes = bytes < liveBytes ? liveBytes - bytes : 0;
+}
+
+// The per-query high-water mark starts from what is already live, such as
+// the plan cache
+void beginQueryStats(void) {
+    queryPeakBytes = liveBytes;
+}
+
+void recordCompilation(int tokens, int symbols, int instructions) {
+    if (queryPeakBytes > compileStats.queryPeakBytes) {
+        compileStats.queryPeakBytes = queryPeakBytes;
+    }
+    compileStats.compilations++;
+    compileStats.tokens += tokens;
+    compileStats.symbols += symbols;
+    compileStats.instructions += instructions;
+}
+
+const CompileStats* getCompileStats(void) {
+    return &compileStats;
+}
+
+void resetCompileStats(void) {
+    memset(&compileStats, 0, sizeof(compileStats));
+    activePhase = -1;
+}
+
+static void printHardwareCounters(const CompileStats* stats) {
+    if (!countersRequested) {
+        return;
+    }
+
+    bool any = false;
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        any = any || isHardwareCounterAvailable((HardwareCounter)c);
+    }
+    if (!any) {
+        fprintf(compilerOutput, "\nContadores de hardware indisponíveis neste ambiente\n");
+        return;
+    }
+
+    fprintf(compilerOutput, "\n%-14s %14s %14s %14s %14s %6s\n",
+            "Fase", "Ciclos", "Instruções", "Cache misses", "Branch misses", "IPC");
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const PhaseStats* phase = &stats->phases[i];
+        fprintf(compilerOutput, "%-14s", CompilePhaseNames[i]);
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (isHardwareCounterAvailable((HardwareCounter)c)) {
+                fprintf(compilerOutput, " %14llu", phase->counters[c]);
+            } else {
+                fprintf(compilerOutput, " %14s", "-");
+            }
+        }
+        unsigned long long cycles = phase->counters[COUNTER_CYCLES];
+        if (cycles > 0 && isHardwareCounterAvailable(COUNTER_INSTRUCTIONS)) {
+            fprintf(compilerOutput, " %6.2f\n", (double)phase->counters[COUNTER_INSTRUCTIONS] / cycles);
+        } else {
+            fprintf(compilerOutput, " %6s\n", "-");
+        }
+    }
+}
+
+void printCompileStats(bool json) {
+    const CompileStats* stats = &compileStats;
+
+    if (json) {
+        fprintf(compilerOutput, "{\"phases\":{");
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            const PhaseStats* phase = &stats->phases[i];
+            fprintf(compilerOutput,
+                    "%s\"%s\":{\"runs\":%d,\"wall_ms\":%.3f,\"cpu_ms\":%.3f,"
+                    "\"allocations\":%ld,\"bytes_allocated\":%zu,\"peak_bytes\":%zu",
+                    i > 0 ? "," : "", CompilePhaseNames[i], phase->runs,
+                    phase->wallSeconds * 1e3, phase->cpuSeconds * 1e3,
+                    phase->allocations, phase->bytesAllocated, phase->peakBytes);
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                if (isHardwareCounterAvailable((HardwareCounter)c)) {
+                    fprintf(compilerOutput, ",\"%s\":%llu", HardwareCounterNames[c], phase->counters[c]);
+                } else {
+                    fprintf(compilerOutput, ",\"%s\":null", HardwareCounterNames[c]);
+                }
+            }
+            fputc('}', compilerOutput);
+        }
+        fprintf(compilerOutput,
+                "},\"counters\":{\"compilations\":%d,\"tokens\":%ld,\"symbols\":%ld,"
+                "\"ir_instructions\":%ld,\"cache_hits\":%d,\"cache_misses\":%d},"
+                "\"memory\":{\"allocator\":\"%s\",\"query_peak_bytes\":%zu,"
+                "\"ir_context_bytes\":%zu,\"semantic_context_bytes\":%zu}}\n",
+                stats->compilations, stats->tokens, stats->symbols, stats->instructions,
+                getPlanCacheHits(), getPlanCacheMisses(), getAllocator()->name,
+                stats->queryPeakBytes, sizeof(IntermediateCodeContext), sizeof(SemanticContext));
+        return;
+    }
+
+    fprintf(compilerOutput, "\n=== Estatísticas de Compilação ===\n");
+    fprintf(compilerOutput, "%-14s %6s %12s %12s %10s %14s %12s\n",
+            "Fase", "Execs", "Wall (ms)", "CPU (ms)", "Alocações", "Alocado (B)", "Pico (B)");
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        const PhaseStats* phase = &stats->phases[i];
+        fprintf(compilerOutput, "%-14s %6d %12.3f %12.3f %10ld %14zu %12zu\n",
+                CompilePhaseNames[i], phase->runs, phase->wallSeconds * 1e3,
+                phase->cpuSeconds * 1e3, phase->allocations, phase->bytesAllocated,
+                phase->peakBytes);
+    }
+    printHardwareCounters(stats);
+
+    fprintf(compilerOutput, "\nCompilações: %d\n", stats->compilations);
+    fprintf(compilerOutput, "Tokens: %ld\n", stats->tokens);
+    fprintf(compilerOutput, "Símbolos: %ld\n", stats->symbols);
+    fprintf(compilerOutput, "Instruções IR: %ld\n", stats->instructions);
+    fprintf(compilerOutput, "Cache de planos: %d acerto(s), %d falha(s)\n",
+            getPlanCacheHits(), getPlanCacheMisses());
+    fprintf(compilerOutput, "Alocador: %s; pico por consulta: %zu bytes\n",
+            getAllocator()->name, stats->queryPeakBytes);
+    fprintf(compilerOutput, "Contextos fixos: código intermediário %zu bytes (estático), "
+            "semântico %zu bytes (pilha)\n",
+            sizeof(IntermediateCodeContext), sizeof(SemanticContext));
+}
@@ -0,0 +1,62 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Compilation phases measured by the statistics surface
+typedef enum {
+    PHASE_LEXICAL,
+    PHASE_NORMALIZE,
+    PHASE_SYNTACTIC,
+    PHASE_SEMANTIC,
+    PHASE_INTERMEDIATE,
+    PHASE_COUNT
+} CompilePhase;
+
+// Hardware events sampled around each phase when --perf-counters is given
+typedef enum {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_COUNT
+} HardwareCounter;
+
+typedef struct {
+    double wallSeconds;
+    double cpuSeconds;
+    size_t bytesAllocated;  // Total requested while the phase was running
+    size_t peakBytes;       // Highest live heap usage seen during the phase
+    long allocations;
+    unsigned long long counters[COUNTER_COUNT];
+    int runs;
+} PhaseStats;
+
+typedef struct {
+    PhaseStats phases[PHASE_COUNT];
+    int compilations;
+    long tokens;
+    long symbols;
+    long instructions;
+    size_t queryPeakBytes;  // Highest live heap usage of any single compilation
+} CompileStats;
+
+extern const char* CompilePhaseNames[];
+extern const char* HardwareCounterNames[];
+
+void beginPhase(CompilePhase phase);
+void endPhase(CompilePhase phase);
+void endActivePhase(void);
+void recordAllocation(size_t bytes);
+void recordRelease(size_t bytes);
+void beginQueryStats(void);
+void recordCompilation(int tokens, int symbols, int instructions);
+const CompileStats* getCompileStats(void);
+void resetCompileStats(void);
+void printCompileStats(bool json);
+bool enableHardwareCounters(void);
+void disableHardwareCounters(void);
+bool isHardwareCounterAvailable(HardwareCounter counter);
+
+#endif
@@ -0,0 +1,132 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../lexico.h"
+#include "../incremental.h"
+#include "../allocator.h"
+#include "../output.h"
+
+// Statement splitting must put a boundary exactly where the lexer emits a
+// ';' token, including around string literals too long for one token.
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static int countSemicolons(const char* text) {
+    FILE* input = fmemopen((void*)text, strlen(text), "r");
+    int line = 1, column = 1;
+    int count = 0;
+    Token token;
+    resetSymbolTable();
+    do {
+        token = getNextToken(input, &line, &column);
+        if (token.type == TOKEN_SEMICOLON) {
+            count++;
+        }
+    } while (token.type != TOKEN_EOF);
+    fclose(input);
+    return count;
+}
+
+// A statement comparing against a literal of 'size' bytes with a ';' at
+// each of the given offsets inside it. A literal longer than the lexer keeps
+// is closed with an empty string after the cut, so the text ends on a ';'.
+static char* literalStatement(int size, const int* semicolons, int semicolonCount) {
+    const char prefix[] = "SELECT a FROM t WHERE b = '";
+    const char* suffix = size > MAX_STRING_CONTENT ? "'';" : "';";
+    size_t prefixLength = strlen(prefix);
+    char* text = malloc(prefixLength + size + strlen(suffix) + 1);
+    memcpy(text, prefix, prefixLength);
+    memset(text + prefixLength, 'x', size);
+    for (int i = 0; i < semicolonCount; i++) {
+        text[prefixLength + semicolons[i]] = ';';
+    }
+    strcpy(text + prefixLength + size, suffix);
+    return text;
+}
+
+static void testSplitMatchesLexer(const char* text, const char* what) {
+    SqlDocument* document = openDocument(text, strlen(text));
+    check(document && document->count == countSemicolons(text), what);
+    if (document) {
+        closeDocument(document);
+    }
+}
+
+// An edit that moves a ';' across the cut must resplit like a fresh open
+static void testEditMatchesOpen(void) {
+    int semicolon[] = {MAX_STRING_CONTENT - 10};
+    char* text = literalStatement(MAX_STRING_CONTENT + 20, semicolon, 1);
+    SqlDocument* document = openDocument(text, strlen(text));
+    check(document != NULL, "long literal opens");
+    if (!document) {
+        free(text);
+        return;
+    }
+
+    char padding[32];
+    memset(padding, 'y', sizeof(padding));
+    size_t offset = strlen("SELECT a FROM t WHERE b = '");
+    check(applyEdit(document, offset, 0, padding, sizeof(padding)), "edit applies");
+
+    SqlDocument* reopened = openDocument(document->text, document->length);
+    check(reopened && reopened->count == document->count,
+          "edited document splits like a fresh open");
+    check(document->count == countSemicolons(document->text),
+          "edited document splits like the lexer");
+    for (int i = 0; reopened && i < document->count && i < reopened->count; i++) {
+        check(document->statements[i].length == reopened->statements[i].length &&
+              document->statements[i].diagnostic.ok == reopened->statements[i].diagnostic.ok,
+              "edited statement matches a fresh open");
+    }
+
+    if (reopened) {
+        closeDocument(reopened);
+    }
+    closeDocument(document);
+    free(text);
+}
+
+int main(void) {
+    compilerOutput = stdout;
+    setAllocator(&trackingAllocator);
+
+    int none[] = {0};
+    char* text = literalStatement(10, none, 0);
+    testSplitMatchesLexer(text, "short literal is one statement");
+    free(text);
+
+    int kept[] = {100};
+    text = literalStatement(200, kept, 1);
+    testSplitMatchesLexer(text, "';' inside a literal is not a boundary");
+    free(text);
+
+    int pastCut[] = {100, MAX_STRING_CONTENT + 20};
+    text = literalStatement(MAX_STRING_CONTENT + 40, pastCut, 2);
+    testSplitMatchesLexer(text, "';' past the cut of a long literal is a boundary");
+    free(text);
+
+    // The lexer drops the byte it stops on, so a ';' there is not a boundary
+    int onCut[] = {MAX_STRING_CONTENT};
+    text = literalStatement(MAX_STRING_CONTENT + 40, onCut, 1);
+    testSplitMatchesLexer(text, "';' on the cut of a long literal is dropped");
+    free(text);
+
+    text = literalStatement(MAX_STRING_CONTENT, none, 0);
+    testSplitMatchesLexer(text, "literal closed on the cut is terminated");
+    free(text);
+
+    testEditMatchesOpen();
+
+    printAllocatorReport();
+    shutdownAllocator();
+    printf("incremental: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../inlist.h"
+#include "../lexico.h"
+#include "../allocator.h"
+
+// Both probe strategies must agree with a linear scan of the literals, on
+// either side of IN_LIST_HASH_THRESHOLD
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// distinct values, each added twice, in a scrambled order
+static ConstantList* buildIntegerList(int distinct) {
+    ConstantList* list = createConstantList(TYPE_INT, distinct * 2, 0);
+    char literal[32];
+    for (int i = 0; i < distinct * 2; i++) {
+        int value = (i * 7919) % distinct;
+        snprintf(literal, sizeof(literal), "%d", value * 3 - 50);
+        addConstant(list, literal);
+    }
+    finishConstantList(list);
+    return list;
+}
+
+static void testIntegers(int distinct) {
+    char what[96];
+    ConstantList* list = buildIntegerList(distinct);
+    ProbeStrategy expected = distinct > IN_LIST_HASH_THRESHOLD ? PROBE_HASH : PROBE_SORTED;
+    snprintf(what, sizeof(what), "%d integers use the %s", distinct, ProbeStrategyNames[expected]);
+    check(list->probe == expected, what);
+    snprintf(what, sizeof(what), "%d integers lose their duplicates", distinct);
+    check(list->count == distinct, what);
+
+    bool agrees = true;
+    for (long long value = -60; value < distinct * 3; value++) {
+        bool member = value >= -50 && (value + 50) % 3 == 0 && (value + 50) / 3 < distinct;
+        agrees = agrees && constantListContainsInteger(list, value) == member;
+        agrees = agrees && constantListContainsReal(list, (double)value) == member;
+    }
+    snprintf(what, sizeof(what), "%d integers probe like a linear scan", distinct);
+    check(agrees, what);
+    check(!constantListContainsReal(list, 1.5), "a fraction is not in an integer list");
+    check(!constantListContainsString(list, "1"), "a string is not in an integer list");
+    freeConstantList(list);
+}
+
+static void testReals(int distinct) {
+    char what[96];
+    ConstantList* list = createConstantList(TYPE_FLOAT, distinct + 2, 0);
+    char literal[32];
+    addConstant(list, "-0.0");
+    addConstant(list, "0.0");
+    for (int i = 1; i < distinct; i++) {
+        snprintf(literal, sizeof(literal), "%d.25", i);
+        addConstant(list, literal);
+    }
+    addConstant(list, "0");
+    finishConstantList(list);
+
+    snprintf(what, sizeof(what), "%d reals count -0.0, 0.0 and 0 once", distinct);
+    check(list->count == distinct, what);
+    snprintf(what, sizeof(what), "%d reals find both zeros", distinct);
+    check(constantListContainsReal(list, 0.0) && constantListContainsReal(list, -0.0) &&
+          constantListContainsInteger(list, 0), what);
+
+    bool agrees = true;
+    for (int i = 1; i < distinct + 5; i++) {
+        agrees = agrees && constantListContainsReal(list, i + 0.25) == (i < distinct);
+        agrees = agrees && !constantListContainsReal(list, i + 0.5);
+        agrees = agrees && !constantListContainsInteger(list, i);
+    }
+    snprintf(what, sizeof(what), "%d reals probe like a linear scan", distinct);
+    check(agrees, what);
+    freeConstantList(list);
+}
+
+static void testStrings(int distinct) {
+    char what[96];
+    ConstantList* list = createConstantList(TYPE_VARCHAR, distinct * 2, (size_t)distinct * 2 * 16);
+    char literal[32];
+    for (int i = 0; i < distinct * 2; i++) {
+        snprintf(literal, sizeof(literal), "'s%d'", i % distinct);
+        addConstant(list, literal);
+    }
+    finishConstantList(list);
+    snprintf(what, sizeof(what), "%d strings lose their duplicates", distinct);
+    check(list->count == distinct, what);
+
+    bool agrees = true;
+    char value[32];
+    for (int i = 0; i < distinct * 2; i++) {
+        snprintf(value, sizeof(value), "s%d", i);
+        agrees = agrees && constantListContainsString(list, value) == (i < distinct);
+    }
+    snprintf(what, sizeof(what), "%d strings probe like a linear scan", distinct);
+    check(agrees, what);
+    check(!constantListContainsString(list, "'s0'"), "probes take values, not quoted literals");
+    check(!constantListContainsInteger(list, 0), "a number is not in a string list");
+    freeConstantList(list);
+}
+
+int main(void) {
+    compilerOutput = stdout;
+    setAllocator(&trackingAllocator);
+
+    int sizes[] = {1, IN_LIST_HASH_THRESHOLD - 1, IN_LIST_HASH_THRESHOLD,
+                   IN_LIST_HASH_THRESHOLD + 1, 1000};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        testIntegers(sizes[i]);
+        testReals(sizes[i]);
+        testStrings(sizes[i]);
+    }
+
+    printAllocatorReport();
+    shutdownAllocator();
+    printf("inlist: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
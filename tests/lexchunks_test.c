@@ -0,0 +1,133 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../lexico.h"
+#include "../lexchunks.h"
+#include "../parser.h"
+#include "../allocator.h"
+
+// Parallel lexing must hand back exactly the token stream getNextToken
+// produces. The worker count is not capped to the CPUs here, so the
+// chunked path runs even on a single-CPU machine.
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Over LEX_PARALLEL_MIN_BYTES of statements, with strings that span lines
+// so some chunk boundaries fall inside them
+static void writeInput(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        exit(1);
+    }
+    for (int i = 0; ftell(out) < LEX_PARALLEL_MIN_BYTES * 2; i++) {
+        fprintf(out, "SELECT c%d, 'x' FROM t%d WHERE a = %d.5 -- note %d\n", i, i % 7, i, i);
+        if (i % 50 == 0) {
+            fprintf(out, "  AND b = 'multi\nline\n%d';\n", i);
+        } else {
+            fprintf(out, ";\n");
+        }
+    }
+    fclose(out);
+}
+
+static Token* lexSerially(const char* path, size_t* count) {
+    FILE* input = fopen(path, "r");
+    size_t capacity = 1024;
+    Token* tokens = malloc(sizeof(Token) * capacity);
+    int line = 1, column = 1;
+    *count = 0;
+    resetSymbolTable();
+    do {
+        if (*count == capacity) {
+            capacity *= 2;
+            tokens = realloc(tokens, sizeof(Token) * capacity);
+        }
+        tokens[*count] = getNextToken(input, &line, &column);
+    } while (tokens[(*count)++].type != TOKEN_EOF);
+    fclose(input);
+    return tokens;
+}
+
+static bool sameToken(const Token* a, const Token* b) {
+    return a->type == b->type && a->line == b->line && a->column == b->column &&
+           strcmp(a->value, b->value) == 0;
+}
+
+static void testMatchesSerial(const char* path, const Token* expected, size_t count,
+                              int threads) {
+    char what[128];
+    setLexThreads(threads);
+    resetSymbolTable();
+
+    FILE* input = fopen(path, "r");
+    LexedTokens lexed;
+    snprintf(what, sizeof(what), "%d threads take the parallel path", threads);
+    check(lexInParallel(input, &lexed), what);
+    check(lexed.count >= 2, "input is split into several chunks");
+
+    size_t i = 0;
+    bool same = true;
+    Token token;
+    do {
+        token = nextLexedToken(&lexed);
+        same = same && i < count && sameToken(&token, &expected[i]);
+        i++;
+    } while (token.type != TOKEN_EOF);
+    snprintf(what, sizeof(what), "%d threads match the serial token stream", threads);
+    check(same && i == count, what);
+
+    freeLexedTokens(&lexed);
+    fclose(input);
+}
+
+// Chunks count against --memory-budget; past it the caller lexes serially
+static void testBudgetFallsBackToSerial(const char* path) {
+    setLexThreads(4);
+    setMemoryBudget(256 * 1024);
+    FILE* input = fopen(path, "r");
+    LexedTokens lexed;
+    check(!lexInParallel(input, &lexed), "over budget falls back to serial");
+    check(ftell(input) == 0, "fallback leaves the stream untouched");
+    fclose(input);
+    setMemoryBudget(DEFAULT_MEMORY_BUDGET);
+}
+
+int main(void) {
+    compilerOutput = stdout;
+    setAllocator(&trackingAllocator);
+    limitLexThreadsToCpus(false);
+
+    char path[] = "/tmp/lexchunks_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    writeInput(path);
+
+    size_t count;
+    Token* expected = lexSerially(path, &count);
+    int threadCounts[] = {2, 3, 8};
+    for (size_t i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++) {
+        testMatchesSerial(path, expected, count, threadCounts[i]);
+    }
+    testBudgetFallsBackToSerial(path);
+    free(expected);
+    unlink(path);
+
+    printAllocatorReport();
+    shutdownAllocator();
+    printf("lexchunks: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
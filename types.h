@@ -15,6 +15,7 @@
 #define MAX_ERROR_LENGTH 512
 #define MAX_KEYWORDS 50
 #define INITIAL_TOKEN_BUFFER_SIZE 1024
+#define DEFAULT_MEMORY_BUDGET (512UL * 1024 * 1024)
 
 // Token types
 typedef enum {
@@ -26,6 +27,7 @@ typedef enum {
     TOKEN_KEYWORD,
     TOKEN_STRING,
     TOKEN_CHAR,
+    TOKEN_PARAMETER,
     TOKEN_COMMENT,
     TOKEN_SEMICOLON,
     TOKEN_EOF,
@@ -73,6 +75,16 @@ typedef enum {
     TYPE_UNKNOWN
 } DataType;
 
+// Aggregate functions, in the order of AggregateFunctionNames
+typedef enum {
+    AGG_COUNT,
+    AGG_SUM,
+    AGG_AVG,
+    AGG_MAX,
+    AGG_MIN,
+    AGG_NONE
+} AggregateFunction;
+
 typedef struct {
     char name[MAX_NAME];
     DataType type;
@@ -122,6 +134,8 @@ typedef struct {
 extern const char *TokenTypeNames[];
 extern CompilerError currentError;
 extern const char* SQL_KEYWORDS[];
+extern const char* AggregateFunctionNames[];
+extern const char* DataTypeNames[];
 
 
 #endif
\ No newline at end of file